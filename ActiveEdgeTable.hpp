@@ -0,0 +1,309 @@
+#ifndef __ACTIVE_EDGE_TABLE_HPP__
+#define __ACTIVE_EDGE_TABLE_HPP__
+/*==============================================================//
+class ActiveEdgeTable
+    Scanline rasterizer for Polygon2D. / Polygon2D用のスキャンライン処理
+    The edges are sorted by their upper end and activated while the
+    subsample rows are stepped from top to bottom, so that a row costs
+    O(active edges) instead of O(edges x subsamples).
+    The coverage is the same as Polygon2D::compute_covered_areas
+    (subsamples of the Pattern, fill rule of the polygon).
+    The edges are read from the edge table of the polygon, so the polygon
+    must not be modified while this object is used.
+    With floating point coordinates, each active edge is evaluated against
+    all subsample rows at once by SubsampleKernels (SIMD on the host).
+
+    辺を上端でソートしておき、サブサンプル行を上から順に進めながら
+    有効な辺だけで交点を計算する。
+    rowは増加する順に渡すこと。
+//==============================================================*/
+#include "resolution.hpp"
+#include "Point2D.hpp"
+#include "Polygon2D.hpp"
+#include "SamplingPattern.hpp"
+#include "SubsampleKernels.hpp"
+#include "SmallVector.hpp"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+template <class Pattern = DefaultSamplingPattern>
+class ActiveEdgeTable{
+
+    //================
+    // data
+    //================
+    public:
+    typedef typename Pattern::coverage_t coverage_t;
+
+    private:
+    // edge table of the polygon / ポリゴンの辺テーブル
+    Polygon2D::EdgeTable table;
+    // indices of the edges sorted by y_min / 上端でソートした辺
+    // The buffers are in the object for the polygons up to Polygon2D::n_inline_vertices edges. / 小さいポリゴンはヒープを使わない
+    SmallVector<uint16_t, Polygon2D::n_inline_vertices> edges;
+    // index of the first edge that is not activated yet / 未登録の最初の辺
+    uint16_t next_edge;
+    // indices of the active edges / 有効な辺
+    SmallVector<uint16_t, Polygon2D::n_inline_vertices> active_edges;
+    Polygon2D::FILL_RULE fill_rule;
+    // sorted crossing points of each subsample row / サブサンプル行ごとの交点(ソート済)
+    SmallVector<coordinate_t, Pattern::n_rows * Polygon2D::n_inline_vertices> crossings;
+    // directions of the edges of the crossing points (for NON_ZERO) / 交点の辺の向き
+    SmallVector<int8_t, Pattern::n_rows * Polygon2D::n_inline_vertices> crossing_dirs;
+    uint16_t n_crossings[Pattern::n_rows];
+    // y of the subsample rows, padded for SubsampleKernels / サブサンプル行のy
+    static const uint8_t n_padded_rows = ( Pattern::n_rows + SubsampleKernels::max_lanes - 1 ) / SubsampleKernels::max_lanes * SubsampleKernels::max_lanes;
+    // bounding x of the crossing points in the current row
+    coordinate_t min_crossing;
+    coordinate_t max_crossing;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    // The buffers beyond the inline size are taken from the arena if it is given / arenaがあれば領域をそこから確保
+    ActiveEdgeTable( const Polygon2D &polygon, FrameArena *arena = NULL );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // Compute the crossing points of the subsample rows in the pixel row iy.
+    // iy must be increasing between calls. Returns false if the row is empty.
+    // iy行のサブサンプル行の交点を計算。空の行ならfalse
+    bool scan_row( const pixel_index_t iy );
+    // The pixels out of [sx_mix, sx_out] are not covered in the scanned row.
+    void get_sx_mix_and_out( pixel_index_t &sx_mix, pixel_index_t &sx_out ) const;
+    // Coverage of the pixels in [start_x, end_x] in the scanned row.
+    void compute_covered_areas( const pixel_index_t start_x, const pixel_index_t end_x, coverage_t *areas ) const;
+
+    private:
+    // index of the pixel including x / xを含む画素
+    static pixel_index_t pixel_index_of( const coordinate_t x );
+    // add the coverage of the span (a, b] in the row j / 区間(a, b]の被覆を加算
+    static void add_span( const pixel_index_t start_x, const pixel_index_t end_x, const uint8_t j, const coordinate_t a, const coordinate_t b, coverage_t *areas );
+    // coverage of the samples of the pixel ix in (a, b] in the row j
+    static coverage_t span_coverage( const pixel_index_t ix, const uint8_t j, const coordinate_t a, const coordinate_t b );
+};
+
+
+// 辺を上端でソートする。
+template <class Pattern>
+ActiveEdgeTable<Pattern>::ActiveEdgeTable( const Polygon2D &polygon, FrameArena *arena ){
+    this->edges.set_arena( arena );
+    this->active_edges.set_arena( arena );
+    this->crossings.set_arena( arena );
+    this->crossing_dirs.set_arena( arena );
+    this->table = polygon.get_edge_table();
+    this->fill_rule = polygon.get_fill_rule();
+    const coordinate_t *y_min = this->table.y_min;
+    this->edges.resize( this->table.n_edges );
+    for( uint16_t e = 0; e < this->table.n_edges; e++ ){
+        this->edges[e] = e;
+    }
+    std::sort( this->edges.begin(), this->edges.end(), [y_min]( const uint16_t a, const uint16_t b ){ return y_min[a] < y_min[b]; } );
+    this->next_edge = 0;
+    this->active_edges.reserve( this->edges.size() );
+    this->crossings.resize( Pattern::n_rows * this->edges.size() );
+    this->crossing_dirs.resize( Pattern::n_rows * this->edges.size() );
+    for( int j = 0; j < Pattern::n_rows; j++ ){
+        this->n_crossings[j] = 0;
+    }
+}
+
+// iy行のサブサンプル行ごとに、有効な辺の交点をソートして保持する。
+// 交点の判定はPolygon2Dの辺テーブルと同じ(y_min < y <= y_max)
+template <class Pattern>
+bool ActiveEdgeTable<Pattern>::scan_row( const pixel_index_t iy ){
+    bool found = false;
+    uint16_t n_edges = this->edges.size();
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    // 辺ごとに、全サブサンプル行の交点をまとめて計算する
+    float ys[n_padded_rows];
+    float xs[n_padded_rows];
+    for( int j = 0; j < n_padded_rows; j++ ){
+        ys[j] = Pattern::y_of_row( iy, ( j < Pattern::n_rows ) ? j : Pattern::n_rows - 1 );
+    }
+    for( int j = 0; j < Pattern::n_rows; j++ ){
+        this->n_crossings[j] = 0;
+    }
+    // 上端が最後の行より上にある辺を追加
+    while( this->next_edge < n_edges && this->table.y_min[this->edges[this->next_edge]] < ys[Pattern::n_rows-1] ){
+        this->active_edges.push_back( this->edges[this->next_edge] );
+        this->next_edge++;
+    }
+    for( uint16_t a = 0; a < this->active_edges.size(); ){
+        uint16_t e = this->active_edges[a];
+        // 下端が最初の行より上にある辺を削除
+        if( this->table.y_max[e] < ys[0] ){
+            this->active_edges[a] = this->active_edges.back();
+            this->active_edges.pop_back();
+            continue;
+        }
+        uint32_t valid = SubsampleKernels::edge_crossings( this->table.y_min[e], this->table.y_max[e], this->table.x_at_y_min[e], this->table.x_at_y_max[e], this->table.dxdy[e], ys, Pattern::n_rows, xs );
+        // 交差する行に挿入 (挿入ソート)
+        while( valid ){
+            int j = __builtin_ctz( valid );
+            valid &= valid - 1;
+            coordinate_t *c = &(this->crossings[ j * n_edges ]);
+            int8_t *d = &(this->crossing_dirs[ j * n_edges ]);
+            uint16_t k = this->n_crossings[j];
+            while( k > 0 && c[k-1] > xs[j] ){
+                c[k] = c[k-1];
+                d[k] = d[k-1];
+                k--;
+            }
+            c[k] = xs[j];
+            d[k] = this->table.dir[e];
+            this->n_crossings[j]++;
+        }
+        a++;
+    }
+    for( int j = 0; j < Pattern::n_rows; j++ ){
+        uint16_t n = this->n_crossings[j];
+        const coordinate_t *c = &(this->crossings[ j * n_edges ]);
+        if( n > 0 ){
+            if( !found || this->min_crossing > c[0] ) this->min_crossing = c[0];
+            if( !found || this->max_crossing < c[n-1] ) this->max_crossing = c[n-1];
+            found = true;
+        }
+    }
+#else
+    for( int j = 0; j < Pattern::n_rows; j++ ){
+        coordinate_t y = Pattern::y_of_row( iy, j );
+        // 上端がyより上にある辺を追加
+        while( this->next_edge < n_edges && this->table.y_min[this->edges[this->next_edge]] < y ){
+            this->active_edges.push_back( this->edges[this->next_edge] );
+            this->next_edge++;
+        }
+        // 下端がyより上にある辺を削除
+        for( uint16_t a = 0; a < this->active_edges.size(); ){
+            if( this->table.y_max[this->active_edges[a]] < y ){
+                this->active_edges[a] = this->active_edges.back();
+                this->active_edges.pop_back();
+            }else{
+                a++;
+            }
+        }
+        // 交点算出 (挿入ソート)
+        coordinate_t *c = &(this->crossings[ j * n_edges ]);
+        int8_t *d = &(this->crossing_dirs[ j * n_edges ]);
+        uint16_t n = 0;
+        for( uint16_t a = 0; a < this->active_edges.size(); a++ ){
+            uint16_t e = this->active_edges[a];
+            coordinate_t x = ( y == this->table.y_max[e] ) ? this->table.x_at_y_max[e] : this->table.x_at_y_min[e] + ( y - this->table.y_min[e] ) * this->table.dxdy[e];
+            uint16_t k = n;
+            while( k > 0 && c[k-1] > x ){
+                c[k] = c[k-1];
+                d[k] = d[k-1];
+                k--;
+            }
+            c[k] = x;
+            d[k] = this->table.dir[e];
+            n++;
+        }
+        this->n_crossings[j] = n;
+        if( n > 0 ){
+            if( !found || this->min_crossing > c[0] ) this->min_crossing = c[0];
+            if( !found || this->max_crossing < c[n-1] ) this->max_crossing = c[n-1];
+            found = true;
+        }
+    }
+#endif
+    return found;
+}
+
+template <class Pattern>
+void ActiveEdgeTable<Pattern>::get_sx_mix_and_out( pixel_index_t &sx_mix, pixel_index_t &sx_out ) const{
+    sx_mix = pixel_index_of( this->min_crossing );
+    sx_out = pixel_index_of( this->max_crossing );
+}
+
+// 交点c[k-1]とc[k]の間(c[k-1], c[k]]にある点は、右側にn-k個の交点がある。
+// EVEN_ODD: n-kが奇数なら内側。
+// NON_ZERO: 右側の交点の向きの和(巻き数)が0でなければ内側。
+template <class Pattern>
+void ActiveEdgeTable<Pattern>::compute_covered_areas( const pixel_index_t start_x, const pixel_index_t end_x, coverage_t *areas ) const{
+
+    // zero clear the areas
+    for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
+        areas[(ix-start_x)] = 0U;
+    }
+
+    uint16_t n_edges = this->edges.size();
+    coordinate_t left = ( start_x - 1 ) * internal_scale;
+    for( int j = 0; j < Pattern::n_rows; j++ ){
+        const coordinate_t *c = &(this->crossings[ j * n_edges ]);
+        uint16_t n = this->n_crossings[j];
+        if( this->fill_rule == Polygon2D::NON_ZERO ){
+            const int8_t *d = &(this->crossing_dirs[ j * n_edges ]);
+            int winding = 0;
+            for( int k = n - 1; k >= 0; k-- ){
+                winding += d[k];
+                if( winding != 0 ){
+                    add_span( start_x, end_x, j, ( k == 0 ) ? left : c[k-1], c[k], areas );
+                }
+            }
+        }else{
+            for( uint16_t k = ( n & 1 ) ? 0 : 1; k < n; k += 2 ){
+                add_span( start_x, end_x, j, ( k == 0 ) ? left : c[k-1], c[k], areas );
+            }
+        }
+    }
+}
+
+template <class Pattern>
+inline void ActiveEdgeTable<Pattern>::add_span( const pixel_index_t start_x, const pixel_index_t end_x, const uint8_t j, const coordinate_t a, const coordinate_t b, coverage_t *areas ){
+    pixel_index_t ix_a = pixel_index_of( a );
+    pixel_index_t ix_b = pixel_index_of( b );
+    if( ix_a < start_x ) ix_a = start_x;
+    if( ix_b > end_x ) ix_b = end_x;
+    if( ix_a > ix_b ){
+        return;
+    }
+    // 両端の画素だけサブサンプルを調べ、間の画素は全て内側
+    areas[ix_a-start_x] += span_coverage( ix_a, j, a, b );
+    if( ix_a == ix_b ){
+        return;
+    }
+    coverage_t full = Pattern::row_full_coverage( j );
+    for( pixel_index_t ix = ix_a + 1; ix < ix_b; ix++ ){
+        areas[ix-start_x] += full;
+    }
+    areas[ix_b-start_x] += span_coverage( ix_b, j, a, b );
+}
+
+template <class Pattern>
+pixel_index_t ActiveEdgeTable<Pattern>::pixel_index_of( const coordinate_t x ){
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    return floor( x + 0.5f );
+#else
+    coordinate_t t = x + half_internal_scale;
+    if( t >= 0 ){
+        return t / internal_scale;
+    }else{
+        return -( ( -t + internal_scale - 1 ) / internal_scale );
+    }
+#endif
+}
+
+// 行jのサンプルはxでソートされているので、(a, b]に入るサンプルは連続した範囲になる。
+template <class Pattern>
+typename ActiveEdgeTable<Pattern>::coverage_t ActiveEdgeTable<Pattern>::span_coverage( const pixel_index_t ix, const uint8_t j, const coordinate_t a, const coordinate_t b ){
+    uint8_t n = Pattern::n_samples_in_row( j );
+    uint8_t first = 0;
+    while( first < n && Pattern::x_of_sample( ix, j, first ) <= a ){
+        first++;
+    }
+    uint8_t last = first;
+    while( last < n && Pattern::x_of_sample( ix, j, last ) <= b ){
+        last++;
+    }
+    if( last == first ){
+        return 0;
+    }
+    return Pattern::row_coverage( j, first, last - 1 );
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include "Affine2D.hpp"
+#include <math.h>
+
+//================
+// constructor / コンストラクタ
+//================
+Affine2D::Affine2D(){
+    this->a = 1;
+    this->b = 0;
+    this->c = 0;
+    this->d = 1;
+    this->tx = 0;
+    this->ty = 0;
+}
+
+Affine2D::Affine2D( const float a, const float b, const float c, const float d, const float tx, const float ty ){
+    this->a = a;
+    this->b = b;
+    this->c = c;
+    this->d = d;
+    this->tx = tx;
+    this->ty = ty;
+}
+
+Affine2D Affine2D::translation( const float tx, const float ty ){
+    return Affine2D( 1, 0, 0, 1, tx, ty );
+}
+
+Affine2D Affine2D::rotation( const float deg ){
+    float rad = deg * 3.1415926535f / 180.0f;
+    float cos_t = cos(rad);
+    float sin_t = sin(rad);
+    return Affine2D( cos_t, -sin_t, sin_t, cos_t, 0, 0 );
+}
+
+Affine2D Affine2D::rotation( const float deg, const Point2D center ){
+    float cx = center.x / internal_scale;
+    float cy = center.y / internal_scale;
+    return translation( cx, cy ) * rotation( deg ) * translation( -cx, -cy );
+}
+
+Affine2D Affine2D::scaling( const float sx, const float sy ){
+    return Affine2D( sx, 0, 0, sy, 0, 0 );
+}
+
+//================
+// Functions / 関数
+//================
+Affine2D Affine2D::operator * ( const Affine2D &t ) const{
+    return Affine2D(
+        this->a * t.a + this->b * t.c,
+        this->a * t.b + this->b * t.d,
+        this->c * t.a + this->d * t.c,
+        this->c * t.b + this->d * t.d,
+        this->a * t.tx + this->b * t.ty + this->tx,
+        this->c * t.tx + this->d * t.ty + this->ty
+    );
+}
+
+bool Affine2D::inverse( Affine2D &inv ) const{
+    float det = determinant();
+    if( fabs( det ) < 1e-12f ){
+        return false;
+    }
+    float inv_det = 1.0f / det;
+    inv.a =  this->d * inv_det;
+    inv.b = -this->b * inv_det;
+    inv.c = -this->c * inv_det;
+    inv.d =  this->a * inv_det;
+    inv.tx = -( inv.a * this->tx + inv.b * this->ty );
+    inv.ty = -( inv.c * this->tx + inv.d * this->ty );
+    return true;
+}
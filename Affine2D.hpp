@@ -0,0 +1,50 @@
+#ifndef __AFFINE2D_HPP__
+#define __AFFINE2D_HPP__
+/*==============================================================//
+class Affine2D
+    2D affine transform in user coordinates (pixels).
+        x' = a * x + b * y + tx
+        y' = c * x + d * y + ty
+    The rotation is in degrees and has the same direction as
+    Polygon2D::rotate.
+    2次元アフィン変換。回転の向きはPolygon2D::rotateと同じ。
+//==============================================================*/
+#include "Point2D.hpp"
+
+class Affine2D{
+
+    //================
+    // variables
+    //================
+    public:
+    float a, b, c, d;
+    float tx, ty;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    // identity / 恒等変換
+    Affine2D();
+    Affine2D( const float a, const float b, const float c, const float d, const float tx, const float ty );
+    static Affine2D translation( const float tx, const float ty );
+    static Affine2D rotation( const float deg );
+    static Affine2D rotation( const float deg, const Point2D center );
+    static Affine2D scaling( const float sx, const float sy );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // (this * t)(p) = this( t(p) ): t is applied first / tを先に適用
+    Affine2D operator * ( const Affine2D &t ) const;
+    inline void apply( const float x, const float y, float &ox, float &oy ) const{
+        ox = this->a * x + this->b * y + this->tx;
+        oy = this->c * x + this->d * y + this->ty;
+    }
+    inline float determinant() const { return this->a * this->d - this->b * this->c; }
+    // Returns false if the transform has no inverse / 逆変換が無い場合はfalse
+    bool inverse( Affine2D &inv ) const;
+};
+
+#endif
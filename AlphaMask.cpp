@@ -0,0 +1,101 @@
+#include "AlphaMask.hpp"
+
+//================
+// constructor / コンストラクタ
+//================
+AlphaMask::AlphaMask(){
+    this->x0 = 0;
+    this->y0 = 0;
+    this->width = 0;
+    this->height = 0;
+}
+
+AlphaMask::AlphaMask( const pixel_index_t x0, const pixel_index_t y0, const int width, const int height ){
+    reset( x0, y0, width, height );
+}
+
+//================
+// Functions / 関数
+//================
+void AlphaMask::reset( const pixel_index_t x0, const pixel_index_t y0, const int width, const int height ){
+    this->x0 = x0;
+    this->y0 = y0;
+    this->width = ( width > 0 ) ? width : 0;
+    this->height = ( height > 0 ) ? height : 0;
+    this->data.assign( this->width * this->height, 0 );
+}
+
+void AlphaMask::box_blur( const int radius ){
+    if( radius <= 0 || this->data.empty() ){
+        return;
+    }
+    this->work.resize( this->data.size() );
+    box_blur_rows( &this->data[0], &this->work[0], radius );
+    box_blur_columns( &this->work[0], &this->data[0], radius );
+}
+
+void AlphaMask::blur( const int radius, const int passes ){
+    for( int n = 0; n < passes; n++ ){
+        box_blur( radius );
+    }
+}
+
+// sum / ( 2 * radius + 1 ) is computed as ( sum * scale ) >> 16 / 除算は逆数の乗算で行う
+static inline uint8_t box_average( const uint32_t sum, const uint32_t scale ){
+    uint32_t v = ( sum * scale + 32768 ) >> 16;
+    return ( v > 255 ) ? 255 : v;
+}
+
+// 窓に入る画素を足し、出る画素を引く(移動和)
+void AlphaMask::box_blur_rows( const uint8_t *src, uint8_t *dst, const int radius ) const{
+    const uint32_t scale = ( 65536 + radius ) / ( 2 * radius + 1 );
+    for( int y = 0; y < this->height; y++ ){
+        const uint8_t *s = src + y * this->width;
+        uint8_t *d = dst + y * this->width;
+        // the window of x = -1 / x = -1の窓
+        uint32_t sum = 0;
+        for( int x = 0; x < radius && x < this->width; x++ ){
+            sum += s[x];
+        }
+        for( int x = 0; x < this->width; x++ ){
+            if( x + radius < this->width ){
+                sum += s[ x + radius ];
+            }
+            if( x - radius - 1 >= 0 ){
+                sum -= s[ x - radius - 1 ];
+            }
+            d[x] = box_average( sum, scale );
+        }
+    }
+}
+
+// 列ごとの移動和を1行分まとめて更新する(メモリを行の順に読む)
+void AlphaMask::box_blur_columns( const uint8_t *src, uint8_t *dst, const int radius ){
+    const uint32_t scale = ( 65536 + radius ) / ( 2 * radius + 1 );
+    this->column_sums.assign( this->width, 0 );
+    uint32_t *sums = &this->column_sums[0];
+    for( int y = 0; y < radius && y < this->height; y++ ){
+        const uint8_t *s = src + y * this->width;
+        for( int x = 0; x < this->width; x++ ){
+            sums[x] += s[x];
+        }
+    }
+    for( int y = 0; y < this->height; y++ ){
+        if( y + radius < this->height ){
+            const uint8_t *s = src + ( y + radius ) * this->width;
+            for( int x = 0; x < this->width; x++ ){
+                sums[x] += s[x];
+            }
+        }
+        if( y - radius - 1 >= 0 ){
+            const uint8_t *s = src + ( y - radius - 1 ) * this->width;
+            for( int x = 0; x < this->width; x++ ){
+                sums[x] -= s[x];
+            }
+        }
+        uint8_t *d = dst + y * this->width;
+        for( int x = 0; x < this->width; x++ ){
+            d[x] = box_average( sums[x], scale );
+        }
+    }
+}
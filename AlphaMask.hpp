@@ -0,0 +1,63 @@
+#ifndef __ALPHA_MASK_HPP__
+#define __ALPHA_MASK_HPP__
+/*==============================================================//
+class AlphaMask
+    8-bit coverage mask (A8) of a rectangle of the canvas, for shadows
+    and blur effects. 0: not covered, 255: fully covered.
+    The mask is placed at (x0, y0) in the pixel coordinates of the canvas.
+    影やぼかし用の8bitの被覆マスク。キャンバスの(x0, y0)に置く。
+
+    box_blur() is separable and uses running sums, so the cost per pixel
+    does not depend on the radius. Three box blurs approximate a Gaussian
+    blur (blur()). Pixels out of the mask are treated as 0.
+    箱型フィルタは移動和で計算するので、1画素あたりの計算量は半径によらない。
+//==============================================================*/
+#include "resolution.hpp"
+#include <stdint.h>
+#include <vector>
+
+class AlphaMask{
+
+    //================
+    // variables
+    //================
+    public:
+    pixel_index_t x0;
+    pixel_index_t y0;
+    int width;
+    int height;
+    private:
+    std::vector<uint8_t> data;
+    // work buffers of the blur (kept to avoid allocation every frame) / ぼかしの作業領域
+    std::vector<uint8_t> work;
+    std::vector<uint32_t> column_sums;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    AlphaMask();
+    AlphaMask( const pixel_index_t x0, const pixel_index_t y0, const int width, const int height );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // Move and resize the mask. All values are cleared to 0. / 位置と大きさを変更し、0で初期化
+    void reset( const pixel_index_t x0, const pixel_index_t y0, const int width, const int height );
+    // the row y (canvas coordinates) / 行y(キャンバスの座標)
+    inline uint8_t *row( const pixel_index_t y ){ return &this->data[ ( y - this->y0 ) * this->width ]; }
+    inline const uint8_t *row( const pixel_index_t y ) const { return &this->data[ ( y - this->y0 ) * this->width ]; }
+    inline uint8_t get( const pixel_index_t x, const pixel_index_t y ) const { return row( y )[ x - this->x0 ]; }
+
+    // Average of ( 2 * radius + 1 ) x ( 2 * radius + 1 ) pixels / 箱型フィルタ
+    void box_blur( const int radius );
+    // passes box blurs, 3 for an approximation of a Gaussian blur / passes回の箱型フィルタ(3回でガウスぼかしの近似)
+    void blur( const int radius, const int passes = 3 );
+
+    private:
+    void box_blur_rows( const uint8_t *src, uint8_t *dst, const int radius ) const;
+    void box_blur_columns( const uint8_t *src, uint8_t *dst, const int radius );
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef __BITMAP_HPP__
+#define __BITMAP_HPP__
+/*==============================================================//
+class Bitmap
+    Read only view of an image in the PixelFormat, the source of
+    Canvas::blit. It does not own the pixels (e.g. a const array in the
+    flash memory, or Canvas::get_bitmap()).
+    The pixels of the color key, if it is set, are transparent.
+    画像の参照(画素は所有しない)。Canvas::blitの転送元。
+    カラーキーを設定すると、その色の画素は透明になる。
+//==============================================================*/
+#include "Color.hpp"
+#include <stdint.h>
+
+template <class PixelFormat>
+class Bitmap{
+
+    //================
+    // variables
+    //================
+    public:
+    typedef typename PixelFormat::Color Color;
+    const uint8_t *data;
+    int width;
+    int height;
+    int stride; // bytes of a row / 1行のバイト数
+    bool use_color_key;
+    Color color_key;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    Bitmap( const uint8_t *data, const int width, const int height, const int stride = 0 ) :
+        data( data ), width( width ), height( height ),
+        stride( ( stride > 0 ) ? stride : PixelFormat::row_bytes( width ) ), use_color_key( false ){}
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    inline void set_color_key( const Color &color ){
+        this->color_key = color;
+        this->use_color_key = true;
+    }
+    inline void reset_color_key(){ this->use_color_key = false; }
+    // only for reading, PixelFormat::Pointer is not const / 読み出し専用
+    inline typename PixelFormat::Pointer get_pointer_to_data( const int x, const int y ) const{
+        return PixelFormat::pixel_pointer( const_cast<uint8_t*>( this->data + y * this->stride ), x, y );
+    }
+    // false if the color is the color key / カラーキーの色ならfalse
+    inline bool is_opaque( const Color &color ) const{
+        if( !this->use_color_key ){
+            return true;
+        }
+        for( int c = 0; c < Color::n_color; c++ ){
+            if( color.color[c] != this->color_key.color[c] ){
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/*==============================================================//
+class ColorConverter
+    Convert the Color of SrcFormat to the Color of DstFormat through
+    8-bit RGB. Nothing is done if the formats are the same.
+    / 画素フォーマット間の色の変換
+//==============================================================*/
+template <class SrcFormat, class DstFormat>
+class ColorConverter{
+    public:
+    static inline void convert( const typename SrcFormat::Color &src, typename DstFormat::Color &dst ){
+        uint8_t r8, g8, b8;
+        SrcFormat::Color_to_RGB888( src, r8, g8, b8 );
+        DstFormat::RGB888_to_Color( r8, g8, b8, dst );
+    }
+};
+template <class Format>
+class ColorConverter<Format, Format>{
+    public:
+    static inline void convert( const typename Format::Color &src, typename Format::Color &dst ){
+        dst = src;
+    }
+};
+
+/*==============================================================//
+class FilterColor
+    The color in which the pixels of SrcFormat are weighted by the
+    bilinear filter of Canvas::blit: the Color of SrcFormat itself, or
+    8-bit RGB of the palette for an indexed format (averaging the
+    indices would give unrelated colors).
+    / 双線形補間で重み付けする色。インデックスカラーはパレットのRGBに展開する
+//==============================================================*/
+template <class SrcFormat, class SrcColor = typename SrcFormat::Color>
+class FilterColor{
+    public:
+    typedef SrcColor Color;
+    static inline void expand( const SrcColor &src, Color &dst ){
+        dst = src;
+    }
+    template <class DstFormat>
+    static inline void convert( const Color &src, typename DstFormat::Color &dst ){
+        ColorConverter<SrcFormat, DstFormat>::convert( src, dst );
+    }
+};
+template <class SrcFormat>
+class FilterColor<SrcFormat, ColorIndex>{
+    public:
+    typedef ColorRGB Color;
+    static inline void expand( const ColorIndex &src, Color &dst ){
+        SrcFormat::Color_to_RGB888( src, dst.color[0], dst.color[1], dst.color[2] );
+    }
+    template <class DstFormat>
+    static inline void convert( const Color &src, typename DstFormat::Color &dst ){
+        DstFormat::RGB888_to_Color( src.color[0], src.color[1], src.color[2], dst );
+    }
+};
+
+#endif
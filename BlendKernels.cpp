@@ -0,0 +1,297 @@
+#include "BlendKernels.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+BlendKernels::ISA BlendKernels::isa = SubsampleKernels::detect_isa();
+BlendKernels::BlendSpanKernel BlendKernels::kernel = BlendKernels::get_kernel( SubsampleKernels::detect_isa() );
+BlendKernels::BlendSpanConstKernel BlendKernels::const_kernel = BlendKernels::get_const_kernel( SubsampleKernels::detect_isa() );
+
+BlendKernels::BlendSpanKernel BlendKernels::get_kernel( const ISA isa ){
+    switch( isa ){
+#if defined(__x86_64__) || defined(__SSE2__)
+        case SubsampleKernels::SSE2: return blend_span_sse2;
+        case SubsampleKernels::AVX2: return blend_span_avx2;
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        case SubsampleKernels::NEON: return blend_span_neon;
+#endif
+        default: return blend_span_scalar;
+    }
+}
+
+BlendKernels::BlendSpanConstKernel BlendKernels::get_const_kernel( const ISA isa ){
+    switch( isa ){
+#if defined(__x86_64__) || defined(__SSE2__)
+        case SubsampleKernels::SSE2: return blend_span_const_sse2;
+        case SubsampleKernels::AVX2: return blend_span_const_avx2;
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        case SubsampleKernels::NEON: return blend_span_const_neon;
+#endif
+        default: return blend_span_const_scalar;
+    }
+}
+
+bool BlendKernels::set_isa( const ISA isa ){
+    BlendSpanKernel k = get_kernel( isa );
+    if( isa != SubsampleKernels::SCALAR && k == blend_span_scalar ){
+        return false;
+    }
+#if defined(__x86_64__) || defined(__SSE2__)
+    if( isa == SubsampleKernels::AVX2 && SubsampleKernels::detect_isa() != SubsampleKernels::AVX2 ){
+        return false;
+    }
+#endif
+    BlendKernels::isa = isa;
+    BlendKernels::kernel = k;
+    BlendKernels::const_kernel = get_const_kernel( isa );
+    return true;
+}
+
+static inline uint16_t load_565( const uint8_t *p_data, const bool msb_first ){
+    return msb_first ? ( ( static_cast<uint16_t>( p_data[0] ) << 8 ) | p_data[1] ) : ( ( static_cast<uint16_t>( p_data[1] ) << 8 ) | p_data[0] );
+}
+static inline void store_565( uint8_t *p_data, const uint16_t v, const bool msb_first ){
+    p_data[ msb_first ? 0 : 1 ] = v >> 8;
+    p_data[ msb_first ? 1 : 0 ] = v & 0xFF;
+}
+
+void BlendKernels::blend_span_scalar( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first ){
+    const uint32_t cur_5_5 = BlendKernels::spread_5_5( cur );
+    const uint32_t cur_6 = cur & 0x07E0;
+    for( int i = 0; i < n; i++ ){
+        uint8_t alpha = alphas[i];
+        if( alpha == 0 ){
+            store_565( p_data, cur, msb_first );
+        }else if( alpha < 128 ){
+            store_565( p_data, BlendKernels::blend_565( load_565( p_data, msb_first ), alpha, ( 128 - alpha ) * cur_5_5, ( 128 - alpha ) * cur_6 ), msb_first );
+        }
+        p_data += 2;
+    }
+}
+
+void BlendKernels::blend_span_const_scalar( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first ){
+    // ( 128 - alpha ) * cur is the same for all pixels / 全画素で共通
+    const uint32_t weighted_cur_5_5 = ( 128 - alpha ) * BlendKernels::spread_5_5( cur );
+    const uint32_t weighted_cur_6 = ( 128 - alpha ) * static_cast<uint32_t>( cur & 0x07E0 );
+    for( int i = 0; i < n; i++ ){
+        store_565( p_data, BlendKernels::blend_565( load_565( p_data, msb_first ), alpha, weighted_cur_5_5, weighted_cur_6 ), msb_first );
+        p_data += 2;
+    }
+}
+
+// The SIMD versions compute ( alpha * ( org - cur ) + ( cur << 7 ) ) >> 7 in 16-bit lanes (|alpha * ( org - cur )| <= 128 * 63),
+// which is equal to ( alpha * org + ( 128 - alpha ) * cur ) >> 7 (see blend_565).
+#if defined(__x86_64__) || defined(__SSE2__)
+// 8 pixels, a: alphas in 16-bit lanes / 8画素分
+static inline __m128i blend_565_sse2( __m128i v, const __m128i a, const __m128i c_lo, const __m128i c_mid, const __m128i c_hi, const bool msb_first ){
+    if( msb_first ){
+        v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+    }
+    const __m128i mask5 = _mm_set1_epi16( 0x1F );
+    const __m128i mask6 = _mm_set1_epi16( 0x3F );
+    __m128i lo = _mm_and_si128( v, mask5 );
+    __m128i mid = _mm_and_si128( _mm_srli_epi16( v, 5 ), mask6 );
+    __m128i hi = _mm_srli_epi16( v, 11 );
+    lo = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( a, _mm_sub_epi16( lo, c_lo ) ), _mm_slli_epi16( c_lo, 7 ) ), 7 );
+    mid = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( a, _mm_sub_epi16( mid, c_mid ) ), _mm_slli_epi16( c_mid, 7 ) ), 7 );
+    hi = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( a, _mm_sub_epi16( hi, c_hi ) ), _mm_slli_epi16( c_hi, 7 ) ), 7 );
+    v = _mm_or_si128( _mm_or_si128( lo, _mm_slli_epi16( mid, 5 ) ), _mm_slli_epi16( hi, 11 ) );
+    if( msb_first ){
+        v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+    }
+    return v;
+}
+
+void BlendKernels::blend_span_sse2( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first ){
+    const __m128i c_lo = _mm_set1_epi16( cur & 0x1F );
+    const __m128i c_mid = _mm_set1_epi16( ( cur >> 5 ) & 0x3F );
+    const __m128i c_hi = _mm_set1_epi16( cur >> 11 );
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 ){
+        __m128i a = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( alphas + i ) ), zero );
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p_data + 2 * i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( p_data + 2 * i ), blend_565_sse2( v, a, c_lo, c_mid, c_hi, msb_first ) );
+    }
+    blend_span_scalar( p_data + 2 * i, alphas + i, n - i, cur, msb_first );
+}
+
+void BlendKernels::blend_span_const_sse2( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first ){
+    const __m128i c_lo = _mm_set1_epi16( cur & 0x1F );
+    const __m128i c_mid = _mm_set1_epi16( ( cur >> 5 ) & 0x3F );
+    const __m128i c_hi = _mm_set1_epi16( cur >> 11 );
+    const __m128i a = _mm_set1_epi16( alpha );
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 ){
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p_data + 2 * i ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( p_data + 2 * i ), blend_565_sse2( v, a, c_lo, c_mid, c_hi, msb_first ) );
+    }
+    blend_span_const_scalar( p_data + 2 * i, n - i, cur, alpha, msb_first );
+}
+
+// 16 pixels / 16画素分
+__attribute__((target("avx2")))
+static inline __m256i blend_565_avx2( __m256i v, const __m256i a, const __m256i c_lo, const __m256i c_mid, const __m256i c_hi, const bool msb_first ){
+    if( msb_first ){
+        v = _mm256_or_si256( _mm256_slli_epi16( v, 8 ), _mm256_srli_epi16( v, 8 ) );
+    }
+    const __m256i mask5 = _mm256_set1_epi16( 0x1F );
+    const __m256i mask6 = _mm256_set1_epi16( 0x3F );
+    __m256i lo = _mm256_and_si256( v, mask5 );
+    __m256i mid = _mm256_and_si256( _mm256_srli_epi16( v, 5 ), mask6 );
+    __m256i hi = _mm256_srli_epi16( v, 11 );
+    lo = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( a, _mm256_sub_epi16( lo, c_lo ) ), _mm256_slli_epi16( c_lo, 7 ) ), 7 );
+    mid = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( a, _mm256_sub_epi16( mid, c_mid ) ), _mm256_slli_epi16( c_mid, 7 ) ), 7 );
+    hi = _mm256_srli_epi16( _mm256_add_epi16( _mm256_mullo_epi16( a, _mm256_sub_epi16( hi, c_hi ) ), _mm256_slli_epi16( c_hi, 7 ) ), 7 );
+    v = _mm256_or_si256( _mm256_or_si256( lo, _mm256_slli_epi16( mid, 5 ) ), _mm256_slli_epi16( hi, 11 ) );
+    if( msb_first ){
+        v = _mm256_or_si256( _mm256_slli_epi16( v, 8 ), _mm256_srli_epi16( v, 8 ) );
+    }
+    return v;
+}
+
+__attribute__((target("avx2")))
+void BlendKernels::blend_span_avx2( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first ){
+    const __m256i c_lo = _mm256_set1_epi16( cur & 0x1F );
+    const __m256i c_mid = _mm256_set1_epi16( ( cur >> 5 ) & 0x3F );
+    const __m256i c_hi = _mm256_set1_epi16( cur >> 11 );
+    int i = 0;
+    for( ; i + 16 <= n; i += 16 ){
+        __m256i a = _mm256_cvtepu8_epi16( _mm_loadu_si128( reinterpret_cast<const __m128i*>( alphas + i ) ) );
+        __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p_data + 2 * i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( p_data + 2 * i ), blend_565_avx2( v, a, c_lo, c_mid, c_hi, msb_first ) );
+    }
+    blend_span_scalar( p_data + 2 * i, alphas + i, n - i, cur, msb_first );
+}
+
+__attribute__((target("avx2")))
+void BlendKernels::blend_span_const_avx2( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first ){
+    const __m256i c_lo = _mm256_set1_epi16( cur & 0x1F );
+    const __m256i c_mid = _mm256_set1_epi16( ( cur >> 5 ) & 0x3F );
+    const __m256i c_hi = _mm256_set1_epi16( cur >> 11 );
+    const __m256i a = _mm256_set1_epi16( alpha );
+    int i = 0;
+    for( ; i + 16 <= n; i += 16 ){
+        __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p_data + 2 * i ) );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( p_data + 2 * i ), blend_565_avx2( v, a, c_lo, c_mid, c_hi, msb_first ) );
+    }
+    blend_span_const_scalar( p_data + 2 * i, n - i, cur, alpha, msb_first );
+}
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+// 8 pixels / 8画素分
+static inline uint16x8_t blend_565_neon( uint16x8_t v, const int16x8_t a, const int16x8_t c_lo, const int16x8_t c_mid, const int16x8_t c_hi, const bool msb_first ){
+    if( msb_first ){
+        v = vreinterpretq_u16_u8( vrev16q_u8( vreinterpretq_u8_u16( v ) ) );
+    }
+    int16x8_t lo = vreinterpretq_s16_u16( vandq_u16( v, vdupq_n_u16( 0x1F ) ) );
+    int16x8_t mid = vreinterpretq_s16_u16( vandq_u16( vshrq_n_u16( v, 5 ), vdupq_n_u16( 0x3F ) ) );
+    int16x8_t hi = vreinterpretq_s16_u16( vshrq_n_u16( v, 11 ) );
+    uint16x8_t rlo = vshrq_n_u16( vreinterpretq_u16_s16( vaddq_s16( vmulq_s16( a, vsubq_s16( lo, c_lo ) ), vshlq_n_s16( c_lo, 7 ) ) ), 7 );
+    uint16x8_t rmid = vshrq_n_u16( vreinterpretq_u16_s16( vaddq_s16( vmulq_s16( a, vsubq_s16( mid, c_mid ) ), vshlq_n_s16( c_mid, 7 ) ) ), 7 );
+    uint16x8_t rhi = vshrq_n_u16( vreinterpretq_u16_s16( vaddq_s16( vmulq_s16( a, vsubq_s16( hi, c_hi ) ), vshlq_n_s16( c_hi, 7 ) ) ), 7 );
+    v = vorrq_u16( vorrq_u16( rlo, vshlq_n_u16( rmid, 5 ) ), vshlq_n_u16( rhi, 11 ) );
+    if( msb_first ){
+        v = vreinterpretq_u16_u8( vrev16q_u8( vreinterpretq_u8_u16( v ) ) );
+    }
+    return v;
+}
+
+void BlendKernels::blend_span_neon( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first ){
+    const int16x8_t c_lo = vdupq_n_s16( cur & 0x1F );
+    const int16x8_t c_mid = vdupq_n_s16( ( cur >> 5 ) & 0x3F );
+    const int16x8_t c_hi = vdupq_n_s16( cur >> 11 );
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 ){
+        int16x8_t a = vreinterpretq_s16_u16( vmovl_u8( vld1_u8( alphas + i ) ) );
+        uint16x8_t v = vreinterpretq_u16_u8( vld1q_u8( p_data + 2 * i ) );
+        vst1q_u8( p_data + 2 * i, vreinterpretq_u8_u16( blend_565_neon( v, a, c_lo, c_mid, c_hi, msb_first ) ) );
+    }
+    blend_span_scalar( p_data + 2 * i, alphas + i, n - i, cur, msb_first );
+}
+
+void BlendKernels::blend_span_const_neon( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first ){
+    const int16x8_t c_lo = vdupq_n_s16( cur & 0x1F );
+    const int16x8_t c_mid = vdupq_n_s16( ( cur >> 5 ) & 0x3F );
+    const int16x8_t c_hi = vdupq_n_s16( cur >> 11 );
+    const int16x8_t a = vdupq_n_s16( alpha );
+    int i = 0;
+    for( ; i + 8 <= n; i += 8 ){
+        uint16x8_t v = vreinterpretq_u16_u8( vld1q_u8( p_data + 2 * i ) );
+        vst1q_u8( p_data + 2 * i, vreinterpretq_u8_u16( blend_565_neon( v, a, c_lo, c_mid, c_hi, msb_first ) ) );
+    }
+    blend_span_const_scalar( p_data + 2 * i, n - i, cur, alpha, msb_first );
+}
+#endif
+
+// Reference of the blend: alpha_blend of each field / 各フィールドをalpha_blendと同じ式で合成した参照値
+static uint16_t blend_565_reference( const uint16_t org, const uint16_t cur, const uint8_t alpha ){
+    const int shifts[3] = { 0, 5, 11 };
+    const int masks[3] = { 0x1F, 0x3F, 0x1F };
+    uint16_t v = 0;
+    for( int f = 0; f < 3; f++ ){
+        int o = ( org >> shifts[f] ) & masks[f];
+        int c = ( cur >> shifts[f] ) & masks[f];
+        v |= ( ( ( alpha * ( o - c ) ) >> 7 ) + c ) << shifts[f];
+    }
+    return v;
+}
+
+// ランダムな画素とalphaで、全実装の結果を参照値と比較する。
+bool BlendKernels::self_test(){
+    const ISA isas[] = { SubsampleKernels::SCALAR, SubsampleKernels::SSE2, SubsampleKernels::AVX2, SubsampleKernels::NEON };
+    static const int max_n = 67;
+    uint8_t src[ 2 * max_n ];
+    uint8_t ref[ 2 * max_n ];
+    uint8_t out[ 2 * max_n ];
+    uint8_t alphas[ max_n ];
+    bool ok = true;
+    unsigned int seed = 1;
+    for( int t = 0; t < 2000 && ok; t++ ){
+        int n = t % max_n + 1;
+        bool msb_first = ( t & 1 ) != 0;
+        bool const_alpha = ( t & 2 ) != 0;
+        uint16_t cur = rand_r( &seed ) & 0xFFFF;
+        uint8_t alpha = rand_r( &seed ) % 129;
+        for( int i = 0; i < n; i++ ){
+            src[2*i] = rand_r( &seed ) & 0xFF;
+            src[2*i+1] = rand_r( &seed ) & 0xFF;
+            // 0と128も含める
+            alphas[i] = ( i % 5 == 0 ) ? ( i % 2 ) * 128 : rand_r( &seed ) % 129;
+        }
+        for( int i = 0; i < n; i++ ){
+            uint16_t org = load_565( src + 2 * i, msb_first );
+            store_565( ref + 2 * i, blend_565_reference( org, cur, const_alpha ? alpha : alphas[i] ), msb_first );
+        }
+        for( uint8_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++ ){
+            BlendSpanKernel kv = get_kernel( isas[k] );
+            if( isas[k] != SubsampleKernels::SCALAR && kv == blend_span_scalar ){
+                continue;
+            }
+#if defined(__x86_64__) || defined(__SSE2__)
+            if( isas[k] == SubsampleKernels::AVX2 && SubsampleKernels::detect_isa() != SubsampleKernels::AVX2 ){
+                continue;
+            }
+#endif
+            memcpy( out, src, 2 * n );
+            if( const_alpha ){
+                get_const_kernel( isas[k] )( out, n, cur, alpha, msb_first );
+            }else{
+                kv( out, alphas, n, cur, msb_first );
+            }
+            if( memcmp( out, ref, 2 * n ) != 0 ){
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,99 @@
+#ifndef __BLEND_KERNELS_HPP__
+#define __BLEND_KERNELS_HPP__
+/*==============================================================//
+class BlendKernels
+    Kernels that blend a color to a span of packed 565 pixels.
+    / 565形式の画素列に色を合成する
+    The fields of a pixel are the bits [0,5), [5,11) and [11,16), so the
+    same kernels work for RGB565 and BGR565. If msb_first is true, the
+    upper byte of each pixel is first in the memory (SSD1331).
+    Each field is blended as ( alpha * ( org - cur ) >> 7 ) + cur,
+    the same as Canvas::alpha_blend. alpha must be in [0, 128].
+
+    Implementations:
+      SCALAR : SWAR, one pixel at a time (ESP32 and others)
+      SSE2   : 8 pixels (x86-64)
+      AVX2   : 16 pixels (x86-64, selected at runtime if the CPU supports it)
+      NEON   : 8 pixels (ARM64)
+    The results of all implementations are the same bit by bit.
+    self_test() checks it against the scalar implementation.
+    test/simd_kernels_test.cpp runs it and compares blend_span of each
+    implementation with alpha_blend of each pixel on the host.
+    The CPU is detected by SubsampleKernels::detect_isa().
+
+    ESP32などではスカラー版を使う。x86-64ではAVX2の有無を実行時に判定する。
+//==============================================================*/
+#include "SubsampleKernels.hpp"
+#include <stdint.h>
+
+class BlendKernels{
+
+    //================
+    // data
+    //================
+    public:
+    typedef SubsampleKernels::ISA ISA;
+    // blend cur to n pixels with the alpha of each pixel
+    typedef void (*BlendSpanKernel)( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first );
+    // blend cur to n pixels with the same alpha
+    typedef void (*BlendSpanConstKernel)( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first );
+
+    private:
+    static BlendSpanKernel kernel;
+    static BlendSpanConstKernel const_kernel;
+    static ISA isa;
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    static inline void blend_span( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first ){
+        kernel( p_data, alphas, n, cur, msb_first );
+    }
+    static inline void blend_span( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first ){
+        const_kernel( p_data, n, cur, alpha, msb_first );
+    }
+    // Spans shorter than this are blended inline by blend_565 (the call costs more than the SIMD saves).
+    // これより短いスパンはblend_565でインライン展開して合成する
+    static const int min_span = 8;
+
+    // Scalar SWAR blend of a pixel. / 1画素のSWAR合成
+    // ( alpha * ( org - cur ) >> 7 ) + cur is equal to ( alpha * org + ( 128 - alpha ) * cur ) >> 7, which has no negative terms.
+    // The two 5-bit fields are spread to bits 0 and 16 of a 32-bit word (the products have 12 bits, so they do not overlap)
+    // and blended by one multiply-add. The 6-bit field is blended in place in another word.
+    // 5bitの2フィールドを32bitの0bit目と16bit目に広げて1回の積和で合成し、6bitのフィールドは別に合成する。
+    static inline uint32_t spread_5_5( const uint16_t v ){
+        return ( v & 0x001F ) | ( static_cast<uint32_t>( v & 0xF800 ) << 5 );
+    }
+    // weighted_cur_5_5 = ( 128 - alpha ) * spread_5_5( cur ), weighted_cur_6 = ( 128 - alpha ) * ( cur & 0x07E0 )
+    static inline uint16_t blend_565( const uint16_t v, const uint8_t alpha, const uint32_t weighted_cur_5_5, const uint32_t weighted_cur_6 ){
+        uint32_t f55 = ( ( alpha * spread_5_5( v ) + weighted_cur_5_5 ) >> 7 ) & 0x001F001F;
+        uint32_t f6 = ( ( alpha * static_cast<uint32_t>( v & 0x07E0 ) + weighted_cur_6 ) >> 7 ) & 0x07E0;
+        return f6 | ( f55 & 0x001F ) | ( ( f55 >> 5 ) & 0xF800 );
+    }
+
+    static inline ISA get_isa(){ return isa; }
+    // Select the implementation. Returns false if it is not supported. / 実装の切り替え(テスト用)
+    static bool set_isa( const ISA isa );
+    // Compare all supported implementations with the scalar one for random pixels and alphas.
+    // Returns true if all results are the same. / 全実装の結果がスカラー版と一致するか確認
+    static bool self_test();
+
+    private:
+    static BlendSpanKernel get_kernel( const ISA isa );
+    static BlendSpanConstKernel get_const_kernel( const ISA isa );
+    static void blend_span_scalar( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first );
+    static void blend_span_const_scalar( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first );
+#if defined(__x86_64__) || defined(__SSE2__)
+    static void blend_span_sse2( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first );
+    static void blend_span_const_sse2( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first );
+    static void blend_span_avx2( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first );
+    static void blend_span_const_avx2( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first );
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+    static void blend_span_neon( uint8_t *p_data, const uint8_t *alphas, const int n, const uint16_t cur, const bool msb_first );
+    static void blend_span_const_neon( uint8_t *p_data, const int n, const uint16_t cur, const uint8_t alpha, const bool msb_first );
+#endif
+};
+
+#endif
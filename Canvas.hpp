@@ -6,11 +6,15 @@ class Canvas
     A super template class of image data with 2D polygon drawing functions.
     It is assumed that this class is used for powerful microcomputers 
     like ESP32.
-    The color space is RGB but the data format should be defined by
-    the child class. 
+    The data format of a pixel is given by the PixelFormat
+    (see PixelFormat.hpp), e.g. PixelFormat_RGB565. The pixels are read
+    and written through its static functions, which are inlined into
+    the drawing loops.
     The drawing functions are written to support alpha channel and 
     antialiasing.
     alpha = 0 is opaque and alpha = 128 is transparent 
+    The subsamples for antialiasing are given by the SamplingPattern
+    (see SamplingPattern.hpp), e.g. GridPattern<5> or Rooks8Pattern.
 
     - Coordinates
     The coordinates (x,y) of the center of the first pixel is (0,0).
@@ -18,28 +22,47 @@ class Canvas
     画像クラスと描画関数を備えたテンプレートクラス。
     ESP32などのマイコン向けに開発。
     描画関数は半透明カラーとアンチエイリアスをサポート。
-    色はRGBを想定しているが、フォーマット(RGB565やRGB888など)を指定するために、
-    このクラスを継承して使う。
+    画素のフォーマット(RGB565など)はPixelFormatで指定する。
     
 //==============================================================*/
 #include <string>
 #include "Color.hpp"
+#include "PixelFormat.hpp"
+#include "Compositing.hpp"
 #include "Polygon2D.hpp"
+#include "FrameArena.hpp"
+#include "ActiveEdgeTable.hpp"
+#include "SignedAreaRasterizer.hpp"
+#include "HalfSpaceRasterizer.hpp"
+#include "SamplingPattern.hpp"
 #include "ColoredPolygon.hpp"
 #include "VectorPicture.hpp"
+#include "Affine2D.hpp"
+#include "Bitmap.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#ifdef USE_TILED_RENDERER
+#include <thread>
+#include <atomic>
+#endif
 
 template <
     unsigned int WIDTH, 
     unsigned int HEIGHT, 
-    unsigned int BYTES_PER_PIXEL,
-    class Color
+    class PixelFormat,
+    class SamplingPattern = DefaultSamplingPattern
 > 
 class Canvas{
 
+    public:
+    typedef typename PixelFormat::Color Color;
+    // pointer to a pixel (uint8_t * except for the formats of less than a byte per pixel) / 画素へのポインタ
+    typedef typename PixelFormat::Pointer Pointer;
+
     //================
     // Variables / 変数
     //================
@@ -47,12 +70,14 @@ class Canvas{
     // Size of the image / 画像サイズ
     static const int width = WIDTH;
     static const int height = HEIGHT; 
-    static const int bytes_per_pixel = BYTES_PER_PIXEL;
+    static const int bytes_per_pixel = PixelFormat::bytes_per_pixel;
     static const int n_pixels = WIDTH * HEIGHT;
-    static const int n_data = WIDTH * HEIGHT * BYTES_PER_PIXEL;
+    static const int row_bytes = PixelFormat::row_bytes( WIDTH );
+    static const int n_data = HEIGHT * row_bytes;
     
     // Pixle values / 画素値
-    uint8_t data[ n_data ];
+    // aligned to 16 bytes, so the rows of 4-byte formats are aligned for SIMD / SIMD向けに16バイト境界に揃える
+    alignas( 16 ) uint8_t data[ n_data ];
 
     // The state of this canvas. / データの読み書き可能状態
     // All drawing functions check this state before drawing. / 描画関数はこの情報を確認してから描画する
@@ -64,9 +89,43 @@ class Canvas{
     protected:
     Canvas_RW_STATE rw_state;
 
+    // How the drawing functions compute the covered area of the edge pixels. / エッジ画素の面積の計算方法
+    public:
+    enum COVERAGE_MODE{
+        SUPERSAMPLING, // subsamples of the SamplingPattern
+        ANALYTIC,      // exact area (SignedAreaRasterizer)
+    };
+    protected:
+    COVERAGE_MODE coverage_mode;
+
+    // The order fill_picture processes the polygons. The result is the same. / fill_pictureの処理順(結果は同じ)
+    public:
+    enum PICTURE_MODE{
+        BACK_TO_FRONT, // blend each polygon in the order of picture.p (painter's algorithm)
+        FRONT_TO_BACK, // find the pixels hidden by opaque polygons in front first, and shade each pixel once
+    };
+    protected:
+    PICTURE_MODE picture_mode;
+
+    // Clip rectangle [clip_x0, clip_x1] x [clip_y0, clip_y1] in pixels. Nothing is drawn out of it.
+    // 描画範囲(画素)。この外には描画しない。
+    pixel_index_t clip_x0;
+    pixel_index_t clip_y0;
+    pixel_index_t clip_x1;
+    pixel_index_t clip_y1;
+    // The number of primitives skipped because they are out of the clip rectangle, and the number of
+    // polygons clipped because they cross the border. / 描画範囲外で省略した数と、境界で切り取った数
+    uint32_t n_culled_primitives;
+    uint32_t n_clipped_primitives;
+    // Arena for the temporaries of the drawing functions (NULL: the heap) / 描画関数の一時データ用の領域
+    FrameArena *frame_arena;
+
     private:
-    // A line buffer for drawing function.
-    uint8_t line_buffer[ width * bytes_per_pixel ];
+    // A line buffer for drawing function (coverage or alpha of each pixel in a row).
+    uint8_t line_buffer[ width ];
+    // Coverage of the pixels in a row for the supersampling / サブサンプルの被覆(1行分)
+    typedef typename SamplingPattern::coverage_t coverage_t;
+    coverage_t coverage_buffer[ width ];
 
 
     //================
@@ -74,11 +133,31 @@ class Canvas{
     //================
     public:
     Canvas();    
-    Canvas( const Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color>& src ){
+    Canvas( const Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern>& src ){
         for( int n = 0; n < n_data; n++ ){
             this->data[n] = src.data[n];
         }
+        this->rw_state = src.rw_state;
+        this->coverage_mode = src.coverage_mode;
+        this->picture_mode = src.picture_mode;
+        this->frame_arena = NULL;
+        reset_clip_rect();
+        reset_clip_counters();
     };   
+    // Copy the pixels and the modes, e.g. to clear by a background canvas every frame.
+    // The frame arena, the clip rectangle and the counters of this canvas are kept.
+    // 画素とモードをコピーする。フレーム領域、描画範囲、カウンタはコピー先のまま
+    Canvas& operator = ( const Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern>& src ){
+        if( this != &src ){
+            for( int n = 0; n < n_data; n++ ){
+                this->data[n] = src.data[n];
+            }
+            this->rw_state = src.rw_state;
+            this->coverage_mode = src.coverage_mode;
+            this->picture_mode = src.picture_mode;
+        }
+        return *this;
+    }
     
 
     //================
@@ -91,21 +170,51 @@ class Canvas{
     inline void set_writable(){this->rw_state = WRITABLE;}
     inline bool is_writable() const {return this->rw_state == WRITABLE;}
 
-    // data access
-    // These two function should be defined in derived class
+    // Coverage Control
+    public:
+    // ANALYTIC is exact for simple polygons, but not on the pixels where overlapping contours (NON_ZERO)
+    // or a self-intersecting outline cross (see SignedAreaRasterizer). Use SUPERSAMPLING for such shapes.
+    // ANALYTICは重なる輪郭・自己交差の交わる画素では正確でない
+    inline void set_coverage_mode( const COVERAGE_MODE mode ){this->coverage_mode = mode;}
+    inline COVERAGE_MODE get_coverage_mode() const {return this->coverage_mode;}
+    inline void set_picture_mode( const PICTURE_MODE mode ){this->picture_mode = mode;}
+    inline PICTURE_MODE get_picture_mode() const {return this->picture_mode;}
+
+    // Clip Control
+    public:
+    // Draw only in [x0, x1] x [y0, y1] (pixels). The rectangle is limited to the canvas.
+    // Polygons out of the rectangle are skipped, and polygons crossing the border are clipped before rasterization.
+    // 描画範囲の設定。範囲外のポリゴンは省略し、境界をまたぐポリゴンは切り取ってから描画する。
+    void set_clip_rect( pixel_index_t x0, pixel_index_t y0, pixel_index_t x1, pixel_index_t y1 );
+    inline void reset_clip_rect(){ set_clip_rect( 0, 0, width-1, height-1 ); }
+    inline void reset_clip_counters(){ this->n_culled_primitives = 0; this->n_clipped_primitives = 0; }
+    inline uint32_t get_n_culled_primitives() const {return this->n_culled_primitives;}
+    inline uint32_t get_n_clipped_primitives() const {return this->n_clipped_primitives;}
+
+    // Temporary memory / 一時データ
+    public:
+    // The outlines of draw_polygon_HQ, the clipped polygons, the edge tables of the temporary polygons
+    // and the buffers of the rasterizers beyond the inline size are taken from the arena instead of the heap.
+    // The drawing loop resets the arena after each frame (the canvas does not). The arena must not be shared with another task.
+    // e.g. arena.reset() after drawer.draw_clock( canvas, ... )
+    // 一時データをヒープではなくアリーナから確保する。アリーナのreset()は描画ループが1フレームごとに行う。
+    inline void set_frame_arena( FrameArena *arena ){this->frame_arena = arena;}
+    inline FrameArena *get_frame_arena() const {return this->frame_arena;}
+
+    // data access (PixelFormat) / 画素の読み書き
     protected:
-    virtual inline void get_Color( uint8_t *p_data, Color &color ) const = 0;
-    virtual inline void set_Color( uint8_t *p_data, Color &color ) = 0;
+    inline void get_Color( const Pointer p_data, Color &color ) const { PixelFormat::get_Color( p_data, color ); }
+    inline void set_Color( const Pointer p_data, const Color &color ) { PixelFormat::set_Color( p_data, color ); }
 
     // data pointer
     public:
     // get the pointer of the first pixel 
     inline uint8_t* get_pointer_to_data() {return data;}
     // get the pointer of the pixel at (x,y). If the position is out of image, the position is shifted to inside of the image.
-    uint8_t* get_pointer_to_data( int x, int y ) ;
+    Pointer get_pointer_to_data( int x, int y ) ;
     protected:
     // get the pointer of the pixel at (x,y). No range check
-    inline uint8_t* get_pointer_to_data_unsafe( int x, int y )  { return (&(data[(y*width+x)*bytes_per_pixel])); }
+    inline Pointer get_pointer_to_data_unsafe( int x, int y )  { return PixelFormat::pixel_pointer( &(data[y*row_bytes]), x, y ); }
 
 
     //---------------------
@@ -114,9 +223,23 @@ class Canvas{
     public:
     // Set all pixel values to val
     void clear( uint8_t val = 0U );
+    // Set all pixels to the color / 全画素を指定色にする
+    inline void clear( const Color &color ){
+        for( int y = 0; y < height; y++ ){
+            PixelFormat::fill_span( get_pointer_to_data_unsafe( 0, y ), width, color );
+        }
+    }
 
     // Draw filled polygon, no edge / ポリゴンを塗りつぶす。ポリゴンは自動で閉じる。
     void fill_polygon( Polygon2D &polygon, Color &color, const uint8_t alpha = 0U);
+    // Fill the polygon by the 8-bit premultiplied color, composited by the Porter-Duff operator Op
+    // (CompositeSrcOver, CompositeAdd, CompositeMultiply or CompositeSrc, see Compositing.hpp).
+    // e.g. canvas.fill_polygon<CompositeAdd>( glow, ColorRGBA8::from_straight( 255, 200, 0, 96 ) );
+    // 乗算済み8bitカラーを合成演算子Opで合成して塗りつぶす(加算で光、乗算で影など)
+    template <class Op>
+    inline void fill_polygon( Polygon2D &polygon, const ColorRGBA8 &color ){
+        fill_polygon_with( polygon, PremultipliedPaint<PixelFormat, Op>( color ) );
+    }
 
     // Draw a segment, from p0 to p1 
     void draw_line( const Point2D p0, const Point2D p1, const float weight, Color &color, const uint8_t alpha = 0U);
@@ -152,37 +275,222 @@ class Canvas{
     void draw_segments_HQ( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha = 0U, const POLYGON_CLOSING_MODE oc = OPEN );
     
     
+    // Fill the polygon by the colors of the gradient / グラデーションで塗りつぶす
+    inline void fill_polygon( Polygon2D &polygon, const Gradient &gradient, const uint8_t alpha = 0U ){
+        fill_polygon_with( polygon, GradientPaint<PixelFormat>( gradient, alpha ) );
+    }
+    // Draw the shadow of the polygon. Call this before drawing the polygon, so the shadow is under it.
+    // The coverage of the polygon moved by (dx, dy) is rendered to an AlphaMask, blurred by 3 box blurs
+    // of the radius (an approximation of a Gaussian blur) and blended with the color.
+    // The shadow is cut at the clip rectangle.
+    // ポリゴンの影を描く(影が下になるようにポリゴンより先に呼ぶ)。(dx, dy)ずらした被覆をぼかしてcolorで合成する。
+    void draw_shadow( const Polygon2D &polygon, const float dx, const float dy, const int radius, Color &color, const uint8_t alpha = 0U );
     inline void fill_polygon( ColoredPolygon2D &polygon ){
-        fill_polygon( polygon.polygon, polygon.face_color, polygon.alpha );
+        if( polygon.gradient ){
+            fill_polygon( polygon.polygon, *polygon.gradient, polygon.alpha );
+        }else{
+            Color color = face_color_of( polygon );
+            fill_polygon( polygon.polygon, color, polygon.alpha );
+        }
     }
+    // Fill all polygons of the picture. The result is the same as calling fill_polygon in the order of picture.p,
+    // but the canvas is swept only once from top to bottom and each row is blended while it is in cache.
+    // In the FRONT_TO_BACK mode (set_picture_mode), the polygons of a row are scanned from the front, the pixels
+    // fully covered by an opaque polygon are not computed for the polygons behind it, and each pixel is read,
+    // blended and written only once. This is faster when polygons overlap a lot.
+    // Exception: with USE_HALF_SPACE_RASTERIZER, fill_polygon draws convex polygons by HalfSpaceRasterizer,
+    // but fill_picture and fill_picture_tiled draw them by rows (ActiveEdgeTable), so the edge pixels may differ slightly.
+    // 全ポリゴンを塗りつぶす。結果はpの順にfill_polygonを呼んだ時と同じだが、上から1回だけ走査する。
+    // (USE_HALF_SPACE_RASTERIZERの時は凸ポリゴンの描画方法が異なり、エッジの画素が僅かに異なることがある)
+    // FRONT_TO_BACKでは手前から処理し、不透明なポリゴンに隠れた画素は奥のポリゴンを計算せず、各画素の読み書きは1回だけ。
+    void fill_picture( const VectorPicture &picture );
+#ifdef USE_TILED_RENDERER
+    // Same as fill_picture, but the canvas is divided into bands of band_height rows (the full width),
+    // and the bands are rendered by n_threads threads (0: the number of cores).
+    // Each polygon is drawn only in the bands its bounding box touches, with one edge table (ActiveEdgeTable
+    // or SignedAreaRasterizer) for each band. The result is the same as fill_picture.
+    // 帯(band_height行)に分割し、複数スレッドで描画する。ポリゴンの辺テーブルは帯ごとに1回作る。結果はfill_pictureと同じ。
+    void fill_picture_tiled( const VectorPicture &picture, unsigned int n_threads = 0 );
+    static const int band_height = 16;
+#endif
     inline void draw_polygon( ColoredPolygon2D &polygon, const float weight){
-        draw_polygon( polygon.polygon, weight, polygon.face_color, polygon.alpha );        
+        Color color = face_color_of( polygon );
+        draw_polygon( polygon.polygon, weight, color, polygon.alpha );
     }
+
+    // Filter of blit / blitの補間
+    enum BLIT_FILTER{
+        NEAREST,  // the nearest pixel of the bitmap / 最近傍
+        BILINEAR, // 2 x 2 pixels of the bitmap, the border is antialiased / 双線形
+    };
+    // Draw the bitmap transformed by transform (pixel coordinates of the bitmap -> the canvas).
+    // Each pixel of the canvas is mapped back to the bitmap by the inverse transform, which is stepped
+    // by 16.16 fixed point deltas along a row. Only the bounding box of the transformed bitmap in the
+    // clip rectangle is scanned. The pixels of the color key of the bitmap are not drawn.
+    // BILINEAR weights the pixels of an indexed bitmap in the RGB colors of its palette.
+    // e.g. canvas.blit( sprite, Affine2D::rotation( deg, center ) * Affine2D::translation( 40, 10 ) );
+    // ビットマップを変換して描画する。キャンバスの各画素を逆変換で転送元に対応させ、行の中は固定小数点の差分で進める。
+    template <class SrcFormat>
+    void blit( const Bitmap<SrcFormat> &src, const Affine2D &transform, const BLIT_FILTER filter = BILINEAR, const uint8_t alpha = 0U );
+    // The pixels of this canvas as a source of blit / blitの転送元としての参照
+    inline Bitmap<PixelFormat> get_bitmap() const { return Bitmap<PixelFormat>( this->data, width, height ); }
     // void draw_circle( const float cx, const float cy, const float radius, const float weight, Color &color, const uint8_t alpha = 0U );
 
 
     private:
     // These functions are private.
-    void fill_convex_polygon( Polygon2D &convex_polygon, Color &color, const uint8_t alpha );
-    void fill_not_convex_polygon( Polygon2D &polygon, Color &color, const uint8_t alpha );
-    inline void alpha_blend( const Color color_org, const Color color_cur, const uint8_t alpha, Color &new_color ) const{
-        for( int c = 0; c < Color::n_color; c++ ){
-            new_color.color[c] = ( ( alpha * ( static_cast<color_alpha_blend_t>(color_org.color[c]) - static_cast<color_alpha_blend_t>(color_cur.color[c]) )) >> 7 ) + color_cur.color[c];
-//            //antialias off
-        //    if( alpha <= 64 ){
-        //        new_color.color[c] = color_cur.color[c];
-        //    }else{
-        //        new_color.color[c] = color_org.color[c];
-        //    }
+    enum CLIP_RESULT{
+        CULLED,  // out of the clip rectangle / 範囲外
+        INSIDE,  // inside of the clip rectangle / 範囲内
+        CLIPPED  // crossing the border, clipped into clipped_polygon / 切り取った
+    };
+    CLIP_RESULT clip_polygon( const Polygon2D &polygon, Polygon2D &clipped_polygon );
+    // Both clip the polygon by the clip rectangle / どちらも描画範囲で切り取ってから描画する
+    // The paint (AlphaPaint, PremultipliedPaint or GradientPaint, see Compositing.hpp) writes the color to the pixels.
+    // paintが画素への書き込み方を決める
+    template <class Paint>
+    void fill_polygon_with( Polygon2D &polygon, const Paint &paint );
+    template <class Paint>
+    void fill_convex_polygon( const Polygon2D &polygon, const Paint &paint );
+    template <class Paint>
+    void fill_not_convex_polygon( const Polygon2D &polygon, const Paint &paint );
+    template <class Paint>
+    void fill_polygon_analytic( const Polygon2D &polygon, const Paint &paint );
+    // Convex polygon by blocks of HALF_SPACE_BLOCK_SIZE x HALF_SPACE_BLOCK_SIZE pixels (HalfSpaceRasterizer)
+    template <class Paint>
+    void fill_convex_polygon_blocks( const Polygon2D &convex_polygon, const Paint &paint );
+    // Draw one row of the polygon in the pixels [x0, x1]. The engine must be stepped row by row (iy increasing).
+    // coverage / areas are scratch buffers of x1 - x0 + 1 elements at least.
+    // 1行分の描画。[x0, x1]の外は描画しない。行は増加する順に渡すこと。
+    template <class Paint>
+    void fill_not_convex_row( ActiveEdgeTable<SamplingPattern> &aet, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, coverage_t *coverage );
+    template <class Paint>
+    void fill_convex_row( const Polygon2D &convex_polygon, ActiveEdgeTable<SamplingPattern> &aet, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, coverage_t *coverage );
+    template <class Paint>
+    void fill_analytic_row( SignedAreaRasterizer &rasterizer, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, uint8_t *areas );
+    // The polygon rasterized for polygon and whether it is drawn as convex: polygon itself, or its only convex piece
+    // if it is convex except for collinear points. fill_polygon, fill_picture and fill_picture_tiled use the same choice.
+    // 実際に描画するポリゴンと凸として描画するか(fill_polygon, fill_picture, fill_picture_tiledで共通)
+    static inline const Polygon2D &fill_target( const Polygon2D &polygon, bool &is_convex ){
+        if( polygon.is_convex_polygon() ){
+            is_convex = true;
+            return polygon;
         }
-        return; 
+        if( polygon.has_convex_pieces() && polygon.get_convex_pieces().size() == 1 ){
+            is_convex = true;
+            return polygon.get_convex_pieces()[0];
+        }
+        is_convex = false;
+        return polygon;
+    }
+    // A polygon of the picture drawn by fill_picture / fill_pictureで描画するポリゴン
+    struct PictureJob{
+        uint16_t index;       // index in picture.p (z-order)
+        const ColoredPolygon2D *cp;
+        const Polygon2D *polygon; // fill_target( cp->polygon ) clipped as fill_polygon does / 描画するポリゴン(切り取り後)
+        bool is_convex;
+        pixel_index_t isy;
+        pixel_index_t iey;
+        ActiveEdgeTable<SamplingPattern> *aet;    // SUPERSAMPLING
+        SignedAreaRasterizer *rasterizer;         // ANALYTIC
+        Color color;
+        // pixels of the current row (FRONT_TO_BACK) / 現在の行の範囲
+        pixel_index_t sx;      // first pixel
+        pixel_index_t sx_inc;  // first pixel of the inside (convex)
+        pixel_index_t sx_mix_1;// first pixel of the right mixed area (convex)
+        pixel_index_t ex;      // last pixel
+    };
+    // Buffers of a row for fill_picture in the FRONT_TO_BACK mode, allocated by each call of fill_picture (not by the canvas)
+    // 手前から処理する時の1行分のバッファ(fill_pictureの呼び出しごとに確保する)
+    struct FrontToBackRow{
+        std::vector<uint8_t> layer_alphas;  // alphas of the visible polygons, width for each / 見えるポリゴンのalpha
+        std::vector<uint16_t> layers;       // the jobs of the visible polygons, front to back / 見えるポリゴン
+        std::vector<uint16_t> opaque_layer; // the front most opaque polygon covering the pixel / 画素を覆う最も手前の不透明なポリゴン
+        std::vector<Color> colors;          // blended colors / 合成中の色
+        std::vector<ColorRGB> span_colors;  // colors of a gradient polygon / グラデーションの色
+        std::vector<uint8_t> state;         // 1 if colors is set / colorsが有効なら1
+    };
+    // Set the job of picture.p[k], the clipped polygons are added to clipped_polygons (reserved for all polygons).
+    // Returns false if the polygon is not drawn. / picture.p[k]の描画の準備。描画しなければfalse
+    bool init_picture_job( const VectorPicture &picture, const uint16_t k, std::vector<Polygon2D> &clipped_polygons, PictureJob &job );
+    // Scan the row iy and set the range [job.sx, job.ex] in the clip rectangle. Returns false if the row is empty.
+    bool scan_picture_row( PictureJob &job, const pixel_index_t iy );
+    // The alpha of each pixel of [job.sx, job.ex] in the scanned row, 128 if not covered. / 各画素の合成のalpha
+    void compute_picture_row_alphas( PictureJob &job, uint8_t *alphas );
+    // Draw the row iy of the active polygons front to back / 1行分を手前から処理して描画
+    void fill_picture_row_front_to_back( std::vector<PictureJob> &jobs, const std::vector<uint16_t> &active_jobs, const pixel_index_t iy, FrontToBackRow &row );
+    // Draw the row iy of the job (BACK_TO_FRONT) / 1行分を描画
+    template <class Paint>
+    void fill_picture_job_row( PictureJob &job, const pixel_index_t iy, const Paint &paint );
+#ifdef USE_TILED_RENDERER
+    // Temporaries of a worker of fill_picture_tiled, reset after each polygon: the edges of a polygon of
+    // about 100 vertices and a row of the analytic coverage. / ワーカーごとの一時データ(ポリゴンごとにリセット)
+    static const size_t band_arena_size = 4096 + sizeof( float ) * WIDTH;
+    // Draw the polygons of the band of the rows [y0, y1] / 帯内のポリゴンを描画
+    template <class Paint>
+    void fill_band_polygon( const PictureJob &job, const Paint &paint, const pixel_index_t y0, const pixel_index_t y1, coverage_t *coverage, uint8_t *areas, FrameArena *arena );
+    void fill_band( const std::vector<PictureJob> &jobs, const std::vector<uint16_t> &band_jobs, const pixel_index_t y0, const pixel_index_t y1, coverage_t *coverage, uint8_t *areas, FrameArena *arena );
+#endif
+    // Draw n pixels of a row of blit. (u, v) is the position in the bitmap of the first pixel and (du, dv) is the step (16.16)
+    // blitの1行分。(u, v)は先頭画素の転送元の座標、(du, dv)は1画素ごとの増分
+    template <class SrcFormat>
+    void blit_row_nearest( const Bitmap<SrcFormat> &src, int32_t u, int32_t v, const int32_t du, const int32_t dv, Pointer ppixel, const int n, const uint8_t alpha );
+    template <class SrcFormat>
+    void blit_row_bilinear( const Bitmap<SrcFormat> &src, int32_t u, int32_t v, const int32_t du, const int32_t dv, Pointer ppixel, const int n, const uint8_t alpha );
+    // Narrow [i0, i1] to the pixels where lo < t0 + dt * i < hi, and 1 more pixel at both ends / lo < t0 + dt * i < hiとなる範囲に狭める
+    static inline void narrow_blit_range( const float t0, const float dt, const float lo, const float hi, int &i0, int &i1 ){
+        if( dt == 0 ){
+            if( t0 <= lo || t0 >= hi ){
+                i1 = i0 - 1;
+            }
+            return;
+        }
+        float ia = ( lo - t0 ) / dt;
+        float ib = ( hi - t0 ) / dt;
+        if( ia > ib ){
+            float tmp = ia;
+            ia = ib;
+            ib = tmp;
+        }
+        if( ia > i0 ) i0 = ( ia > i1 ) ? i1 + 1 : static_cast<int>( floor( ia ) );
+        if( ib < i1 ) i1 = ( ib < i0 ) ? i0 - 1 : static_cast<int>( ceil( ib ) );
+    }
+    // Write the color with the alpha / alphaで合成して書き込む
+    inline void blend_pixel( Pointer ppixel, const Color &color, const uint8_t alpha ){
+        if( alpha == 0 ){
+            set_Color( ppixel, color );
+        }else{
+            Color org_color;
+            get_Color( ppixel, org_color );
+            alpha_blend( org_color, color, alpha, org_color );
+            set_Color( ppixel, org_color );
+        }
+    }
+    // Alpha of the pixel covered by Coverage::count(area) / Coverage::n_samples / 被覆から合成のalpha
+    template <class Coverage>
+    static inline uint8_t covered_alpha( const typename Coverage::coverage_t area, const uint8_t alpha ){
+        return AlphaPaint<PixelFormat>::template covered_alpha<Coverage>( area, alpha );
+    }
+    inline void alpha_blend( const Color &color_org, const Color &color_cur, const uint8_t alpha, Color &new_color ) const{
+        PixelFormat::alpha_blend( color_org, color_cur, alpha, new_color );
     }
 
     // 
     public:
     bool saveBMP(std::string file_name) ;
+    // Convert the rows [y0, y0 + n_rows) to DstFormat into dst (DstFormat::row_bytes( width ) bytes a row).
+    // e.g. an indexed canvas to RGB565 while it is sent to the display in bands.
+    // 行を別の画素フォーマットに変換する(インデックスカラーを表示器に送る時など)
+    template <class DstFormat>
+    void convert_rows( const int y0, const int n_rows, uint8_t *dst );
     private:
-    virtual void Color_to_RGB888( Color &color,  uint8_t &r8, uint8_t &g8, uint8_t &b8 ) const = 0;
+    inline void Color_to_RGB888( const Color &color,  uint8_t &r8, uint8_t &g8, uint8_t &b8 ) const { PixelFormat::Color_to_RGB888( color, r8, g8, b8 ); }
+    // face_color in the Color of the format (the nearest color of the palette for an indexed canvas) / face_colorを画素フォーマットの色に
+    static inline Color face_color_of( const ColoredPolygon2D &polygon ){
+        Color color;
+        PixelFormat::ColorRGB_to_Color( polygon.face_color, color );
+        return color;
+    }
 
     // [min,max]に制限
     static inline void clip_min_max( pixel_index_t &target, pixel_index_t min, pixel_index_t max ){
@@ -200,9 +508,18 @@ class Canvas{
 // Constructor
 // Set writable / 書き込み可能状態で初期化
 // All values are set to zero. / 画素値は全て0
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> :: Canvas(){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> :: Canvas(){
     rw_state = WRITABLE;
+    picture_mode = BACK_TO_FRONT;
+    frame_arena = NULL;
+    reset_clip_rect();
+    reset_clip_counters();
+#ifdef USE_ANALYTIC_COVERAGE
+    coverage_mode = ANALYTIC;
+#else
+    coverage_mode = SUPERSAMPLING;
+#endif
     for( int n = 0; n < n_data; n++ ){
         data[n] = 0;
     }
@@ -211,172 +528,715 @@ Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> :: Canvas(){
 // Drawing functions
 
 // Set all pixel values to val
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::clear( uint8_t val ){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::clear( uint8_t val ){
     for( int n = 0; n < n_data; n++ ){
         data[n] = val;
     }
 }
 
+// Set the clip rectangle. It is limited to the canvas. / 描画範囲の設定
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::set_clip_rect( pixel_index_t x0, pixel_index_t y0, pixel_index_t x1, pixel_index_t y1 ){
+    clip_min_max( x0, 0, width-1 );
+    clip_min_max( x1, 0, width-1 );
+    clip_min_max( y0, 0, height-1 );
+    clip_min_max( y1, 0, height-1 );
+    this->clip_x0 = x0;
+    this->clip_y0 = y0;
+    this->clip_x1 = x1;
+    this->clip_y1 = y1;
+}
+
 // Get the pointer to the pixel value at (x,y).
 // If x and/or y are out of range, they are cliped.
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-uint8_t* Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::get_pointer_to_data( int x, int y ) {
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+typename Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern>::Pointer Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::get_pointer_to_data( int x, int y ) {
     if( x < 0 ) x = 0;
     if( x >= width ) x = width - 1;
     if( y < 0 ) y = 0;
     if( y >= height ) y = height - 1;
-    return &(data[ ( y * height + x ) * bytes_per_pixel ]);    
+    return get_pointer_to_data_unsafe( x, y );
 }
 
 
 // Draw filled polygon by the color, r, g, b, and alpha.
 // If the number of points of the polygon is less than two, this function do nothing.
 // 多角形を指定の色(RGBA)で塗りつぶす. 点の数が2以下の場合は何もしない。
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::fill_polygon( Polygon2D &polygon, Color &color, const uint8_t alpha){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_polygon( Polygon2D &polygon, Color &color, const uint8_t alpha){
+    fill_polygon_with( polygon, AlphaPaint<PixelFormat>( color, alpha ) );
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_polygon_with( Polygon2D &polygon, const Paint &paint ){
     if( polygon.size() >= 3 ){
-        if( polygon.is_convex_polygon() ){
-            // Fast drawing for convex / 凸形状限定高速描画
-            fill_convex_polygon( polygon, color, alpha );
+        bool is_convex;
+        const Polygon2D &target = fill_target( polygon, is_convex );
+        if( is_convex ){
+            // Fast drawing for convex, or convex except for collinear points / 凸形状限定高速描画(一直線に並ぶ点を除けば凸を含む)
+            fill_convex_polygon( target, paint );
         }else{
             // Drawing for non convex polygon / 凸以外
-            fill_not_convex_polygon( polygon, color, alpha );
+            // Several convex pieces are not used: one pass by the active edge table is faster than a pass for each piece.
+            // 複数のピースに分かれる場合は、ピースごとに描画するより辺テーブルで一度に描画する方が速い
+            fill_not_convex_polygon( polygon, paint );
         }
     }
 }
 
+// バウンディングボックスで描画範囲の内外を判定し、境界をまたぐ時だけ切り取る。
+// 描画範囲より1画素外側の画素境界で切り取るので、範囲内の画素のサンプルの内外判定は変わらない。
+// (凸用の範囲計算get_start_x_of_the_areasは、行の上下の画素境界で交点を調べるため、1画素の余裕を持たせる)
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+typename Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern>::CLIP_RESULT Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::clip_polygon( const Polygon2D &polygon, Polygon2D &clipped_polygon ){
+    pixel_index_t isx, isy, iex, iey;
+    polygon.get_bounding_box(isx, isy, iex, iey);
+    if( iex < this->clip_x0 || isx > this->clip_x1 || iey < this->clip_y0 || isy > this->clip_y1 ){
+        this->n_culled_primitives++;
+        return CULLED;
+    }
+    if( this->clip_x0 <= isx && iex <= this->clip_x1 && this->clip_y0 <= isy && iey <= this->clip_y1 ){
+        return INSIDE;
+    }
+    polygon.clip( ( this->clip_x0 - 1 ) * internal_scale - half_internal_scale, ( this->clip_y0 - 1 ) * internal_scale - half_internal_scale,
+                  ( this->clip_x1 + 1 ) * internal_scale + half_internal_scale, ( this->clip_y1 + 1 ) * internal_scale + half_internal_scale,
+                  clipped_polygon, this->frame_arena );
+    if( clipped_polygon.size() < 3 ){
+        this->n_culled_primitives++;
+        return CULLED;
+    }
+    this->n_clipped_primitives++;
+    return CLIPPED;
+}
+
 // this function is private and should be called by fill_polygon();
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::fill_not_convex_polygon( Polygon2D &polygon, Color &color, const uint8_t alpha){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_not_convex_polygon( const Polygon2D &polygon, const Paint &paint){
+    Polygon2D clipped_polygon;
+    CLIP_RESULT clip = clip_polygon( polygon, clipped_polygon );
+    if( clip == CULLED ){
+        return;
+    }
+    const Polygon2D &target = ( clip == CLIPPED ) ? clipped_polygon : polygon;
+    if( this->coverage_mode == ANALYTIC ){
+        fill_polygon_analytic( target, paint );
+        return;
+    }
     // get minimum rectangle
     pixel_index_t isx, isy, iex, iey;
-    polygon.get_bounding_box(isx, isy, iex, iey);
-    if(isy < 0) isy = 0;
-    if(iey >= height) iey = height - 1;    
+    target.get_bounding_box(isx, isy, iex, iey);
+    if(isy < this->clip_y0) isy = this->clip_y0;
+    if(iey > this->clip_y1) iey = this->clip_y1;
+
+    // 辺を上端でソートし、行を進めながら有効な辺だけで交点を求める。
+    ActiveEdgeTable<SamplingPattern> aet( target, this->frame_arena );
 
     // pixel loop
-    pixel_index_t pixel_index = 0;
     for( pixel_index_t iy = isy; iy <= iey; iy++ ){
-        // 高速化のため、行の中に完全に包含されるポリゴンは無視する。
-        // 行の中で、外->混合->包含<-->混合<-->外と変化する。
-        // 最初に混合変化する座標 sx_mix, 最後に外に出るsx_outを計算
-        pixel_index_t sx_mix, sx_out;
-        polygon.get_sx_mix_and_out( iy, sx_mix, sx_out );
-        // 座標を画面内に制限
-        clip_min_max( sx_mix, 0, width-1);
-        clip_min_max( sx_out, 0, width-1 );
-        // 描画
-        Color org_color;
-        Color new_color;
-        uint8_t *ppixel = get_pointer_to_data_unsafe(sx_mix, iy);
-        // 先に占有率を計算
-        polygon.compute_covered_areas( iy, sx_mix, sx_out, line_buffer );
-        for( int ix = sx_mix; ix <= sx_out; ix++ ){
-            uint8_t total_alpha = 128 - ( 128 - alpha ) * line_buffer[ix-sx_mix] / Polygon2D::n_subpixels;
-            //fill_pixel( ppixel, r, g, b, total_alpha );
-            get_Color( ppixel, org_color );
-            alpha_blend( org_color, color, total_alpha, new_color );
-            set_Color( ppixel, new_color );
-            ppixel += bytes_per_pixel;
-        }
+        fill_not_convex_row( aet, iy, paint, this->clip_x0, this->clip_x1, coverage_buffer );
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_not_convex_row( ActiveEdgeTable<SamplingPattern> &aet, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, coverage_t *coverage ){
+    // 行の中で、外->混合->包含<-->混合<-->外と変化する。
+    // 最初に混合変化する座標 sx_mix, 最後に外に出るsx_outを計算
+    if( !aet.scan_row( iy ) ){
+        return;
+    }
+    pixel_index_t sx_mix, sx_out;
+    aet.get_sx_mix_and_out( sx_mix, sx_out );
+    // 座標を画面内に制限
+    clip_min_max( sx_mix, x0, x1 );
+    clip_min_max( sx_out, x0, x1 );
+    // 描画
+    Pointer ppixel = get_pointer_to_data_unsafe(sx_mix, iy);
+    // 先に占有率を計算
+    aet.compute_covered_areas( sx_mix, sx_out, coverage );
+    paint.template covered_span<SamplingPattern>( ppixel, sx_mix, iy, coverage, sx_out - sx_mix + 1 );
+}
+
+// this function is private and should be called by fill_convex_polygon() or fill_not_convex_polygon();
+// 面積を厳密に計算して描画する。凸、非凸共通
+// ポリゴンは描画範囲で切り取り済み
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_polygon_analytic( const Polygon2D &polygon, const Paint &paint){
+    // get minimum rectangle
+    pixel_index_t isx, isy, iex, iey;
+    polygon.get_bounding_box(isx, isy, iex, iey);
+    if(isy < this->clip_y0) isy = this->clip_y0;
+    if(iey > this->clip_y1) iey = this->clip_y1;
+
+    SignedAreaRasterizer rasterizer( polygon, this->frame_arena );
+    for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+        fill_analytic_row( rasterizer, iy, paint, this->clip_x0, this->clip_x1, line_buffer );
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_analytic_row( SignedAreaRasterizer &rasterizer, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, uint8_t *areas ){
+    if( !rasterizer.scan_row( iy ) ){
+        return;
     }
+    pixel_index_t sx_mix, sx_out;
+    rasterizer.get_sx_mix_and_out( sx_mix, sx_out );
+    clip_min_max( sx_mix, x0, x1 );
+    clip_min_max( sx_out, x0, x1 );
+    Pointer ppixel = get_pointer_to_data_unsafe(sx_mix, iy);
+    rasterizer.compute_covered_areas( sx_mix, sx_out, areas );
+    paint.template covered_span<SignedAreaRasterizer>( ppixel, sx_mix, iy, areas, sx_out - sx_mix + 1 );
 }
 
 // this function is private and should be called by fill_polygon();
 // 凸多角形に限定して高速に描画する関数
 // 凸多角形でない場合は、意図した動作をしない
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::fill_convex_polygon( Polygon2D &convex_polygon, Color &color, const uint8_t alpha ){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_convex_polygon( const Polygon2D &polygon, const Paint &paint ){
+    // 凸多角形を矩形で切り取っても凸のまま
+    Polygon2D clipped_polygon;
+    CLIP_RESULT clip = clip_polygon( polygon, clipped_polygon );
+    if( clip == CULLED ){
+        return;
+    }
+    const Polygon2D &convex_polygon = ( clip == CLIPPED ) ? clipped_polygon : polygon;
+    if( this->coverage_mode == ANALYTIC ){
+        fill_polygon_analytic( convex_polygon, paint );
+        return;
+    }
+#ifdef USE_HALF_SPACE_RASTERIZER
+    fill_convex_polygon_blocks( convex_polygon, paint );
+    return;
+#endif
     // get minimum rectangle
     pixel_index_t isx, isy, iex, iey;
     convex_polygon.get_bounding_box(isx, isy, iex, iey);
-    if(isy < 0) isy = 0;
-    if(iey >= this->height) iey = this->height - 1;    
+    if(isy < this->clip_y0) isy = this->clip_y0;
+    if(iey > this->clip_y1) iey = this->clip_y1;
     
+    // 混合領域の面積は、行を進めながら有効な辺だけで求める。
+    ActiveEdgeTable<SamplingPattern> aet( convex_polygon, this->frame_arena );
+
     // row loop
     for( pixel_index_t iy = isy; iy <= iey; iy++ ){
-        // 行の中で、外->混合->包含->混合->外と変化する。
-        // 変化する座標 sx_mix_0, sx_inc, sx_min_1, sx_out1を計算
-        pixel_index_t sx_mix_0, sx_inc, sx_mix_1, sx_out1;
-        convex_polygon.get_start_x_of_the_areas( iy, sx_mix_0, sx_inc, sx_mix_1, sx_out1 );
-        clip_min_max( sx_mix_0, 0, width-1 );
-        clip_min_max( sx_inc, 0, width-1 );
-        clip_min_max( sx_mix_1, 0, width-1 );
-        clip_min_max( sx_out1, 0, width-1 );
-        // 左側混合領域 (面積判定と描画)
-        uint8_t *ppixel  = this->get_pointer_to_data_unsafe( sx_mix_0, iy );
-        //&(this->data[ ( iy * width + sx_mix_0 ) * bytes_per_pixel ]); 
-
-        // 高速化のため、ポリゴンが画素を覆っている面積を1行分計算してから色を処理する。
-        convex_polygon.compute_covered_areas( iy, sx_mix_0, sx_inc-1, line_buffer );
-        Color org_color;
-        Color new_color;
-        for( pixel_index_t ix = sx_mix_0; ix < sx_inc; ix++ ){
-            uint8_t total_alpha = 128 - ( 128 - alpha ) * line_buffer[ix-sx_mix_0] / Polygon2D::n_subpixels;
-            get_Color( ppixel, org_color );
-            alpha_blend( org_color, color, total_alpha, new_color );
-            set_Color( ppixel, new_color );
-            ppixel += bytes_per_pixel;
+        fill_convex_row( convex_polygon, aet, iy, paint, this->clip_x0, this->clip_x1, coverage_buffer );
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_convex_row( const Polygon2D &convex_polygon, ActiveEdgeTable<SamplingPattern> &aet, const pixel_index_t iy, const Paint &paint, const pixel_index_t x0, const pixel_index_t x1, coverage_t *coverage ){
+    if( !aet.scan_row( iy ) ){
+        return;
+    }
+    // 行の中で、外->混合->包含->混合->外と変化する。
+    // 変化する座標 sx_mix_0, sx_inc, sx_min_1, sx_out1を計算
+    pixel_index_t sx_mix_0, sx_inc, sx_mix_1, sx_out1;
+    convex_polygon.get_start_x_of_the_areas( iy, sx_mix_0, sx_inc, sx_mix_1, sx_out1 );
+    clip_min_max( sx_mix_0, x0, x1 );
+    clip_min_max( sx_inc, x0, x1 );
+    clip_min_max( sx_mix_1, x0, x1 );
+    clip_min_max( sx_out1, x0, x1 );
+    // 左側混合領域 (面積判定と描画)
+    Pointer ppixel  = this->get_pointer_to_data_unsafe( sx_mix_0, iy );
+
+    // 高速化のため、ポリゴンが画素を覆っている面積を1行分計算してから色を処理する。
+    aet.compute_covered_areas( sx_mix_0, sx_inc-1, coverage );
+    paint.template covered_span<SamplingPattern>( ppixel, sx_mix_0, iy, coverage, sx_inc - sx_mix_0 );
+    ppixel = PixelFormat::advance( ppixel, sx_inc - sx_mix_0 );
+    // 包含領域 (塗りつぶし)
+    if( sx_mix_1 > sx_inc ){
+        paint.full_span( ppixel, sx_inc, iy, sx_mix_1 - sx_inc );
+        ppixel = PixelFormat::advance( ppixel, sx_mix_1 - sx_inc );
+    }
+    // 右混合領域 (面積判定と描画)
+    // 高速化のため、ポリゴンが画素を覆っている面積を1行分計算してから色を処理する。
+    aet.compute_covered_areas( sx_mix_1, sx_out1, coverage );
+    paint.template covered_span<SamplingPattern>( ppixel, sx_mix_1, iy, coverage, sx_out1 - sx_mix_1 + 1 );
+}
+
+// this function is private and should be called by fill_convex_polygon();
+// ブロック単位で辺関数を評価し、完全に内側のブロックは画素ごとの判定なしで塗りつぶす。
+// ブロックはキャンバスの原点に揃える。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_convex_polygon_blocks( const Polygon2D &convex_polygon, const Paint &paint ){
+    typedef HalfSpaceRasterizer<SamplingPattern, HALF_SPACE_BLOCK_SIZE> Rasterizer;
+    static const int block_size = Rasterizer::block_size;
+    // get minimum rectangle
+    pixel_index_t isx, isy, iex, iey;
+    convex_polygon.get_bounding_box(isx, isy, iex, iey);
+    clip_min_max( isx, this->clip_x0, this->clip_x1 );
+    clip_min_max( iex, this->clip_x0, this->clip_x1 );
+    clip_min_max( isy, this->clip_y0, this->clip_y1 );
+    clip_min_max( iey, this->clip_y0, this->clip_y1 );
+
+    Rasterizer rasterizer( convex_polygon, this->frame_arena );
+    for( pixel_index_t by = isy - isy % block_size; by <= iey; by += block_size ){
+        pixel_index_t y0 = ( by < isy ) ? isy : by;
+        pixel_index_t y1 = ( by + block_size - 1 > iey ) ? iey : by + block_size - 1;
+        for( pixel_index_t bx = isx - isx % block_size; bx <= iex; bx += block_size ){
+            typename Rasterizer::BLOCK_STATE state = rasterizer.classify_block( bx, by );
+            if( state == Rasterizer::OUTSIDE ){
+                continue;
+            }
+            pixel_index_t x0 = ( bx < isx ) ? isx : bx;
+            pixel_index_t x1 = ( bx + block_size - 1 > iex ) ? iex : bx + block_size - 1;
+            for( pixel_index_t iy = y0; iy <= y1; iy++ ){
+                Pointer ppixel = get_pointer_to_data_unsafe( x0, iy );
+                if( state == Rasterizer::INSIDE ){
+                    // 包含ブロック (塗りつぶし)
+                    paint.full_span( ppixel, x0, iy, x1 - x0 + 1 );
+                }else{
+                    // 混合ブロック (面積判定と描画)
+                    rasterizer.compute_covered_areas( x0, x1, iy, coverage_buffer );
+                    paint.template covered_span<SamplingPattern>( ppixel, x0, iy, coverage_buffer, x1 - x0 + 1 );
+                }
+            }
         }
-        // 包含領域 (塗りつぶし)
-        for( pixel_index_t ix = sx_inc; ix < sx_mix_1; ix++ ){
-            get_Color( ppixel, org_color );
-            alpha_blend( org_color, color, alpha, new_color );
-            set_Color( ppixel, new_color );
-            ppixel += bytes_per_pixel;
-        }
-        // 右混合領域 (面積判定と描画)
-        // 高速化のため、ポリゴンが画素を覆っている面積を1行分計算してから色を処理する。
-        convex_polygon.compute_covered_areas( iy, sx_mix_1, sx_out1, line_buffer );
-        for( pixel_index_t ix = sx_mix_1; ix <= sx_out1; ix++ ){
-            uint8_t total_alpha = 128 - ( 128 - alpha ) * line_buffer[ix-sx_mix_1] / Polygon2D::n_subpixels;
-            get_Color( ppixel, org_color );
-            alpha_blend( org_color, color, total_alpha, new_color );
-            set_Color( ppixel, new_color );
-            ppixel += bytes_per_pixel;
+    }
+}
+
+// fill_polygonと同じく、描画するポリゴン(fill_target)を描画範囲で切り取る。
+// 切り取ったポリゴンはclipped_polygonsに追加する(予約済みで、ポインタは変わらない)。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+bool Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::init_picture_job( const VectorPicture &picture, const uint16_t k, std::vector<Polygon2D> &clipped_polygons, PictureJob &job ){
+    if( picture.p[k].polygon.size() < 3 ){
+        return false;
+    }
+    const Polygon2D &target = fill_target( picture.p[k].polygon, job.is_convex );
+    Polygon2D clipped_polygon;
+    CLIP_RESULT clip = clip_polygon( target, clipped_polygon );
+    if( clip == CULLED ){
+        return false;
+    }
+    if( clip == CLIPPED ){
+        clipped_polygons.push_back( clipped_polygon );
+        job.polygon = &clipped_polygons.back();
+    }else{
+        job.polygon = &target;
+    }
+    pixel_index_t isx, iex;
+    job.polygon->get_bounding_box( isx, job.isy, iex, job.iey );
+    if( job.isy < this->clip_y0 ) job.isy = this->clip_y0;
+    if( job.iey > this->clip_y1 ) job.iey = this->clip_y1;
+    // only the guard band is left after clipping (fill_polygon draws no row either) / 切り取った結果が範囲外の余白だけ
+    if( job.isy > job.iey ){
+        return false;
+    }
+    job.index = k;
+    job.cp = &picture.p[k];
+    job.color = face_color_of( picture.p[k] );
+    job.aet = NULL;
+    job.rasterizer = NULL;
+    return true;
+}
+
+// 全ポリゴンを開始行でバケットに分け、上から1回だけ走査する。
+// 各行では、その行にかかるポリゴンをpの順(奥から手前)に合成するので、結果はfill_polygonを順に呼んだ時と同じ。
+// 凸判定は1ポリゴンにつき1回だけ行う。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_picture( const VectorPicture &picture ){
+    // Polygons on the canvas / 描画対象のポリゴン
+    std::vector<PictureJob> jobs;
+    jobs.reserve( picture.p.size() );
+    // reserved, so the pointers of the jobs are not changed / 予約しておき、ポインタが変わらないようにする
+    std::vector<Polygon2D> clipped_polygons;
+    clipped_polygons.reserve( picture.p.size() );
+    std::vector<ActiveEdgeTable<SamplingPattern> > aets;
+    std::vector<SignedAreaRasterizer> rasterizers;
+    if( this->coverage_mode == ANALYTIC ){
+        rasterizers.reserve( picture.p.size() );
+    }else{
+        aets.reserve( picture.p.size() );
+    }
+    for( uint16_t k = 0; k < picture.p.size(); k++ ){
+        PictureJob job;
+        if( !init_picture_job( picture, k, clipped_polygons, job ) ){
+            continue;
+        }
+        if( this->coverage_mode == ANALYTIC ){
+            rasterizers.push_back( SignedAreaRasterizer( *job.polygon ) );
+            job.rasterizer = &rasterizers.back();
+        }else{
+            aets.push_back( ActiveEdgeTable<SamplingPattern>( *job.polygon ) );
+            job.aet = &aets.back();
+        }
+        jobs.push_back( job );
+    }
+
+    // bucket by the start row (stable, so the z-order is kept in a bucket) / 開始行でバケット分け
+    std::vector<uint16_t> bucket_start( height + 1, 0 );
+    for( uint16_t n = 0; n < jobs.size(); n++ ){
+        bucket_start[ jobs[n].isy + 1 ]++;
+    }
+    for( int iy = 0; iy < height; iy++ ){
+        bucket_start[ iy + 1 ] += bucket_start[ iy ];
+    }
+    std::vector<uint16_t> sorted_jobs( jobs.size() );
+    {
+        std::vector<uint16_t> pos( bucket_start.begin(), bucket_start.end() - 1 );
+        for( uint16_t n = 0; n < jobs.size(); n++ ){
+            sorted_jobs[ pos[ jobs[n].isy ]++ ] = n;
         }
     }
+
+    // sweep / 上から走査
+    // active_jobs is kept sorted by the job index (= z-order) / 有効なポリゴン(z順)
+    std::vector<uint16_t> active_jobs;
+    active_jobs.reserve( jobs.size() );
+    // for FRONT_TO_BACK (allocated at the first row) / 手前から処理する時の作業領域(最初の行で確保)
+    FrontToBackRow front_to_back_row;
+    for( pixel_index_t iy = 0; iy < height; iy++ ){
+        for( uint16_t b = bucket_start[iy]; b < bucket_start[iy+1]; b++ ){
+            uint16_t n = sorted_jobs[b];
+            active_jobs.insert( std::lower_bound( active_jobs.begin(), active_jobs.end(), n ), n );
+        }
+        for( uint16_t a = 0; a < active_jobs.size(); ){
+            if( jobs[ active_jobs[a] ].iey < iy ){
+                active_jobs.erase( active_jobs.begin() + a );
+                continue;
+            }
+            a++;
+        }
+        if( this->picture_mode == FRONT_TO_BACK ){
+            fill_picture_row_front_to_back( jobs, active_jobs, iy, front_to_back_row );
+            continue;
+        }
+        for( uint16_t a = 0; a < active_jobs.size(); a++ ){
+            PictureJob &job = jobs[ active_jobs[a] ];
+            if( job.cp->gradient ){
+                fill_picture_job_row( job, iy, GradientPaint<PixelFormat>( *job.cp->gradient, job.cp->alpha ) );
+            }else{
+                fill_picture_job_row( job, iy, AlphaPaint<PixelFormat>( job.color, job.cp->alpha ) );
+            }
+        }
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_picture_job_row( PictureJob &job, const pixel_index_t iy, const Paint &paint ){
+    if( this->coverage_mode == ANALYTIC ){
+        fill_analytic_row( *job.rasterizer, iy, paint, this->clip_x0, this->clip_x1, line_buffer );
+    }else if( job.is_convex ){
+        fill_convex_row( *job.polygon, *job.aet, iy, paint, this->clip_x0, this->clip_x1, coverage_buffer );
+    }else{
+        fill_not_convex_row( *job.aet, iy, paint, this->clip_x0, this->clip_x1, coverage_buffer );
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+bool Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::scan_picture_row( PictureJob &job, const pixel_index_t iy ){
+    if( this->coverage_mode == ANALYTIC ){
+        if( !job.rasterizer->scan_row( iy ) ){
+            return false;
+        }
+        job.rasterizer->get_sx_mix_and_out( job.sx, job.ex );
+    }else{
+        if( !job.aet->scan_row( iy ) ){
+            return false;
+        }
+        if( job.is_convex ){
+            // fill_convex_row()と同じ範囲
+            job.polygon->get_start_x_of_the_areas( iy, job.sx, job.sx_inc, job.sx_mix_1, job.ex );
+            clip_min_max( job.sx_inc, this->clip_x0, this->clip_x1 );
+            clip_min_max( job.sx_mix_1, this->clip_x0, this->clip_x1 );
+        }else{
+            job.aet->get_sx_mix_and_out( job.sx, job.ex );
+        }
+    }
+    clip_min_max( job.sx, this->clip_x0, this->clip_x1 );
+    clip_min_max( job.ex, this->clip_x0, this->clip_x1 );
+    return true;
+}
+
+// fill_*_row()で合成する時と同じalphaを求める。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::compute_picture_row_alphas( PictureJob &job, uint8_t *alphas ){
+    const uint8_t alpha = job.cp->alpha;
+    if( this->coverage_mode == ANALYTIC ){
+        job.rasterizer->compute_covered_areas( job.sx, job.ex, alphas );
+        for( pixel_index_t ix = job.sx; ix <= job.ex; ix++ ){
+            alphas[ix-job.sx] = covered_alpha<SignedAreaRasterizer>( alphas[ix-job.sx], alpha );
+        }
+    }else if( job.is_convex ){
+        // 左側混合領域
+        job.aet->compute_covered_areas( job.sx, job.sx_inc-1, coverage_buffer );
+        for( pixel_index_t ix = job.sx; ix < job.sx_inc; ix++ ){
+            alphas[ix-job.sx] = covered_alpha<SamplingPattern>( coverage_buffer[ix-job.sx], alpha );
+        }
+        // 包含領域
+        for( pixel_index_t ix = job.sx_inc; ix < job.sx_mix_1; ix++ ){
+            alphas[ix-job.sx] = alpha;
+        }
+        // 右混合領域
+        job.aet->compute_covered_areas( job.sx_mix_1, job.ex, coverage_buffer );
+        for( pixel_index_t ix = job.sx_mix_1; ix <= job.ex; ix++ ){
+            alphas[ix-job.sx] = covered_alpha<SamplingPattern>( coverage_buffer[ix-job.sx_mix_1], alpha );
+        }
+    }else{
+        job.aet->compute_covered_areas( job.sx, job.ex, coverage_buffer );
+        for( pixel_index_t ix = job.sx; ix <= job.ex; ix++ ){
+            alphas[ix-job.sx] = covered_alpha<SamplingPattern>( coverage_buffer[ix-job.sx], alpha );
+        }
+    }
+}
+
+// 手前のポリゴンから順に、各画素を完全に覆う不透明なポリゴン(alpha = 0)を探す。
+// そのポリゴンより奥は合成しても色が変わらないので計算を省き、行の全画素が隠れたポリゴンは被覆も計算しない。
+// 最後に各画素を1回だけ読み、見えるポリゴンだけを奥から順に合成して書き込む。
+// 合成の計算はalpha_blendを順に呼んだ時と同じなので、結果はBACK_TO_FRONTと同じになる。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_picture_row_front_to_back( std::vector<PictureJob> &jobs, const std::vector<uint16_t> &active_jobs, const pixel_index_t iy, FrontToBackRow &row ){
+    static const uint16_t not_hidden = 0xFFFF;
+    if( active_jobs.empty() ){
+        return;
+    }
+    if( row.state.empty() ){
+        row.opaque_layer.resize( width );
+        row.colors.resize( width );
+        row.span_colors.resize( width );
+        row.state.resize( width );
+    }
+    if( row.layer_alphas.size() < active_jobs.size() * width ){
+        row.layer_alphas.resize( active_jobs.size() * width );
+    }
+    row.layers.clear();
+    pixel_index_t row_sx = this->clip_x1 + 1;
+    pixel_index_t row_ex = this->clip_x0 - 1;
+    // front to back / 手前から
+    for( int a = active_jobs.size() - 1; a >= 0; a-- ){
+        PictureJob &job = jobs[ active_jobs[a] ];
+        if( !scan_picture_row( job, iy ) ){
+            continue;
+        }
+        // opaque_layerは[row_sx, row_ex]だけ初期化しておく
+        if( row_sx > row_ex ){
+            row_sx = job.sx;
+            row_ex = job.sx - 1;
+        }
+        for( pixel_index_t ix = job.sx; ix < row_sx; ix++ ){
+            row.opaque_layer[ix] = not_hidden;
+        }
+        for( pixel_index_t ix = row_ex + 1; ix <= job.ex; ix++ ){
+            row.opaque_layer[ix] = not_hidden;
+        }
+        if( row_sx > job.sx ) row_sx = job.sx;
+        if( row_ex < job.ex ) row_ex = job.ex;
+        // 全画素が隠れていれば省略
+        pixel_index_t ix = job.sx;
+        while( ix <= job.ex && row.opaque_layer[ix] != not_hidden ){
+            ix++;
+        }
+        if( ix > job.ex ){
+            continue;
+        }
+        uint16_t l = row.layers.size();
+        uint8_t *alphas = &row.layer_alphas[ l * width ];
+        compute_picture_row_alphas( job, alphas );
+        for( ix = job.sx; ix <= job.ex; ix++ ){
+            if( alphas[ix-job.sx] == 0 && row.opaque_layer[ix] == not_hidden ){
+                row.opaque_layer[ix] = l;
+            }
+        }
+        row.layers.push_back( active_jobs[a] );
+    }
+
+    // shade each pixel once / 各画素を1回だけ合成
+    // 隠れた画素は画素値を読まず、覆うポリゴンの合成(alpha = 0)から始める。それ以外は画素値から始めて、見えるポリゴンを奥から合成する。
+    for( pixel_index_t ix = row_sx; ix <= row_ex; ix++ ){
+        row.state[ix] = ( row.opaque_layer[ix] != not_hidden ) ? 1 : 0;
+    }
+    for( int l = row.layers.size() - 1; l >= 0; l-- ){
+        const PictureJob &job = jobs[ row.layers[l] ];
+        const uint8_t *alphas = &row.layer_alphas[ l * width ];
+        const Gradient *gradient = job.cp->gradient;
+        if( gradient ){
+            gradient->shade_span( job.sx, iy, job.ex - job.sx + 1, &row.span_colors[0] );
+        }
+        for( pixel_index_t ix = job.sx; ix <= job.ex; ix++ ){
+            uint8_t alpha = alphas[ix-job.sx];
+            // 透明(合成しても変わらない)か、手前の不透明なポリゴンに隠れている
+            if( alpha >= 128 || row.opaque_layer[ix] < l ){
+                continue;
+            }
+            if( row.state[ix] == 0 ){
+                get_Color( get_pointer_to_data_unsafe( ix, iy ), row.colors[ix] );
+                row.state[ix] = 1;
+            }
+            Color color = job.color;
+            if( gradient ){
+                PixelFormat::ColorRGB_to_Color( row.span_colors[ix-job.sx], color );
+            }
+            alpha_blend( row.colors[ix], color, alpha, row.colors[ix] );
+        }
+    }
+    Pointer ppixel = get_pointer_to_data_unsafe( row_sx, iy );
+    for( pixel_index_t ix = row_sx; ix <= row_ex; ix++, ppixel = PixelFormat::advance( ppixel, 1 ) ){
+        if( row.state[ix] ){
+            set_Color( ppixel, row.colors[ix] );
+        }
+    }
+}
+
+#ifdef USE_TILED_RENDERER
+// ポリゴンをバウンディングボックスが重なる帯に登録(ビニング)し、帯ごとに独立に描画する。
+// 帯は重ならず、帯内ではpの順に描画するので、結果はfill_pictureと同じ。
+// 帯は全幅なので、ポリゴンの辺テーブル(AET)は帯ごとに1回だけ作る(タイルごとに作ると横に並ぶタイルの数だけ作り直す)。
+// 辺テーブルはスレッドを起動する前に作成しておく(遅延作成は複数スレッドから呼べないため)。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_picture_tiled( const VectorPicture &picture, unsigned int n_threads ){
+    static const int n_bands = ( height + band_height - 1 ) / band_height;
+
+    // binning / 帯への登録
+    std::vector<PictureJob> jobs;
+    jobs.reserve( picture.p.size() );
+    std::vector<Polygon2D> clipped_polygons;
+    clipped_polygons.reserve( picture.p.size() );
+    std::vector< std::vector<uint16_t> > bins( n_bands );
+    for( uint16_t k = 0; k < picture.p.size(); k++ ){
+        PictureJob job;
+        if( !init_picture_job( picture, k, clipped_polygons, job ) ){
+            continue;
+        }
+        job.polygon->get_edge_table();
+        for( int b = job.isy / band_height; b <= job.iey / band_height; b++ ){
+            bins[b].push_back( jobs.size() );
+        }
+        jobs.push_back( job );
+    }
+
+    if( n_threads == 0 ){
+        n_threads = std::thread::hardware_concurrency();
+        if( n_threads == 0 ) n_threads = 1;
+    }
+    if( n_threads > n_bands ) n_threads = n_bands;
+
+    // worker: take the next band until all bands are drawn / 未処理の帯を順に取り出して描画
+    std::atomic<int> next_band( 0 );
+    auto worker = [&](){
+        std::vector<coverage_t> coverage( width );
+        std::vector<uint8_t> areas( width );
+        FrameArena arena( band_arena_size );
+        for( int b = next_band++; b < n_bands; b = next_band++ ){
+            if( bins[b].empty() ){
+                continue;
+            }
+            pixel_index_t y0 = b * band_height;
+            pixel_index_t y1 = y0 + band_height - 1;
+            // 帯を描画範囲に制限
+            if( y0 < this->clip_y0 ) y0 = this->clip_y0;
+            if( y1 > this->clip_y1 ) y1 = this->clip_y1;
+            fill_band( jobs, bins[b], y0, y1, &coverage[0], &areas[0], &arena );
+        }
+    };
+    std::vector<std::thread> threads;
+    for( unsigned int n = 1; n < n_threads; n++ ){
+        threads.push_back( std::thread( worker ) );
+    }
+    worker();
+    for( unsigned int n = 0; n < threads.size(); n++ ){
+        threads[n].join();
+    }
 }
 
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_band( const std::vector<PictureJob> &jobs, const std::vector<uint16_t> &band_jobs, const pixel_index_t y0, const pixel_index_t y1, coverage_t *coverage, uint8_t *areas, FrameArena *arena ){
+    for( uint16_t n = 0; n < band_jobs.size(); n++ ){
+        const PictureJob &job = jobs[ band_jobs[n] ];
+        if( job.cp->gradient ){
+            fill_band_polygon( job, GradientPaint<PixelFormat>( *job.cp->gradient, job.cp->alpha ), y0, y1, coverage, areas, arena );
+        }else{
+            fill_band_polygon( job, AlphaPaint<PixelFormat>( job.color, job.cp->alpha ), y0, y1, coverage, areas, arena );
+        }
+        arena->reset();
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class Paint>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::fill_band_polygon( const PictureJob &job, const Paint &paint, const pixel_index_t y0, const pixel_index_t y1, coverage_t *coverage, uint8_t *areas, FrameArena *arena ){
+    const Polygon2D &target = *job.polygon;
+    const pixel_index_t isy = ( job.isy < y0 ) ? y0 : job.isy;
+    const pixel_index_t iey = ( job.iey > y1 ) ? y1 : job.iey;
+    if( this->coverage_mode == ANALYTIC ){
+        SignedAreaRasterizer rasterizer( target, arena );
+        for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+            fill_analytic_row( rasterizer, iy, paint, this->clip_x0, this->clip_x1, areas );
+        }
+    }else{
+        ActiveEdgeTable<SamplingPattern> aet( target, arena );
+        if( job.is_convex ){
+            for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+                fill_convex_row( target, aet, iy, paint, this->clip_x0, this->clip_x1, coverage );
+            }
+        }else{
+            for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+                fill_not_convex_row( aet, iy, paint, this->clip_x0, this->clip_x1, coverage );
+            }
+        }
+    }
+}
+#endif
+
 // fill the pixel including the point p0. / 点p0が含まれる画素を塗りつぶす。
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_dot( Point2D p0, Color &color, const uint8_t alpha){
+// 画素の範囲はget_bounding_boxと同じ(負の座標も切り捨てにしない)
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_dot( Point2D p0, Color &color, const uint8_t alpha){
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    pixel_index_t iy = floor(p0.y+half_internal_scale);
+    pixel_index_t ix = floor(p0.x+half_internal_scale);
+#else
+    if( p0.x + half_internal_scale < 0 || p0.y + half_internal_scale < 0 ){
+        this->n_culled_primitives++;
+        return;
+    }
     pixel_index_t iy = (p0.y+half_internal_scale)/internal_scale;
     pixel_index_t ix = (p0.x+half_internal_scale)/internal_scale;
-    if( 0 <= ix && ix < width && 0<= iy && iy < height ){
-        Color org_color;
-        Color new_color;
-        uint8_t* ppixel = &data[iy*width+ix];
-        get_Color( ppixel, org_color );
-        alpha_blend( org_color, color, alpha, new_color );
-        set_Color( ppixel, new_color );
+#endif
+    if( ix < this->clip_x0 || ix > this->clip_x1 || iy < this->clip_y0 || iy > this->clip_y1 ){
+        this->n_culled_primitives++;
+        return;
     }
+    Color org_color;
+    Color new_color;
+    Pointer ppixel = get_pointer_to_data_unsafe( ix, iy );
+    get_Color( ppixel, org_color );
+    alpha_blend( org_color, color, alpha, new_color );
+    set_Color( ppixel, new_color );
 }
 
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_line( const Point2D p0, const Point2D p1, const float weight, Color &color, const uint8_t alpha){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_line( const Point2D p0, const Point2D p1, const float weight, Color &color, const uint8_t alpha){
     // 長方形polygon作成
     Polygon2D line_segment;
+    line_segment.set_arena( this->frame_arena );
     line_segment.line_segment( p0, p1, weight );
-    fill_convex_polygon(line_segment, color, alpha);
+    fill_convex_polygon( line_segment, AlphaPaint<PixelFormat>( color, alpha ) );
 }
 
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_polygon( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_polygon( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha){
     draw_segments( polygon, weight, color, alpha, CLOSE );
 }
 
 // 塗りつぶしなしポリゴン。閉じる。低速高品質版
 // 高品質版:線の幅を考慮して、交点をきちんと算出する。
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_polygon_HQ( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha ){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_polygon_HQ( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha ){
     draw_segments_HQ( polygon, weight, color, alpha, CLOSE );
 }
 
 
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha, const POLYGON_CLOSING_MODE oc ){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_segments( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha, const POLYGON_CLOSING_MODE oc ){
     // 各辺をdrawLineという簡易実装
     int np = polygon.size();
     Point2D p0 = polygon.get_Point2D(0);
@@ -392,8 +1252,8 @@ void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments( Polygon2D &p
 }
 
 
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments_HQ( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha, const POLYGON_CLOSING_MODE oc ){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_segments_HQ( Polygon2D &polygon, const float weight, Color &color, const uint8_t alpha, const POLYGON_CLOSING_MODE oc ){
     int np = polygon.size();
     if( np <= 1 ){
         // do nothing
@@ -405,6 +1265,8 @@ void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments_HQ( Polygon2D
         Point2D p0, p1, p2, p0i, p0o, p1i, p1o;
         Polygon2D leftside_points;
         Polygon2D rightside_points;
+        leftside_points.set_arena( this->frame_arena );
+        rightside_points.set_arena( this->frame_arena );
         float length_internal = weight * internal_scale * 0.5f;
         if( oc == CLOSE ){
             p0 = polygon.get_Point2D(np-1); // previous vertex
@@ -438,11 +1300,13 @@ void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments_HQ( Polygon2D
                 p1 = p2;
                 p2 = polygon.get_Point2D((n+1)%np);
             }
-            rightside_points.concat(leftside_points);
-            fill_not_convex_polygon( rightside_points, color, alpha );
+            // 外側と内側を別の輪郭にする(継ぎ目の辺を作らない)
+            rightside_points.add_contour(leftside_points);
+            fill_not_convex_polygon( rightside_points, AlphaPaint<PixelFormat>( color, alpha ) );
         }else{ // OPEN
             Point2D p0, p1, p2, p0i, p0o, p1i, p1o;
             Polygon2D edge;
+            edge.set_arena( this->frame_arena );
 
             p0 = polygon.get_Point2D(0); // previous vertex
             p1 = polygon.get_Point2D(1);    // current vertex
@@ -494,11 +1358,208 @@ void Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::draw_segments_HQ( Polygon2D
                 leftside_points.add_Point2D(p1 + v);
             }
             rightside_points.concat_inversely(leftside_points);
-            fill_not_convex_polygon( rightside_points, color, alpha );
+            fill_not_convex_polygon( rightside_points, AlphaPaint<PixelFormat>( color, alpha ) );
+
+        }
+    }
+}
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::draw_shadow( const Polygon2D &polygon, const float dx, const float dy, const int radius, Color &color, const uint8_t alpha ){
+    static const int passes = 3;
+    if( polygon.size() < 3 || alpha >= 128 ){
+        return;
+    }
+    Polygon2D shadow;
+    shadow.set_arena( this->frame_arena );
+    shadow = polygon;
+    shadow += Point2D( dx, dy );
+    // the blur spreads the coverage by radius pixels in each pass / 1回のぼかしで半径分広がる
+    const int margin = ( radius > 0 ) ? radius * passes : 0;
+    pixel_index_t isx, isy, iex, iey;
+    shadow.get_bounding_box( isx, isy, iex, iey );
+    isx -= margin;
+    isy -= margin;
+    iex += margin;
+    iey += margin;
+    if( iex < this->clip_x0 || isx > this->clip_x1 || iey < this->clip_y0 || isy > this->clip_y1 ){
+        this->n_culled_primitives++;
+        return;
+    }
+    clip_min_max( isx, this->clip_x0, this->clip_x1 );
+    clip_min_max( iex, this->clip_x0, this->clip_x1 );
+    clip_min_max( isy, this->clip_y0, this->clip_y1 );
+    clip_min_max( iey, this->clip_y0, this->clip_y1 );
 
+    // coverage -> blur -> blend / 被覆の描画、ぼかし、合成
+    // the mask is allocated by each call, not kept by the canvas / マスクは呼び出しごとに確保する
+    AlphaMask shadow_mask( isx, isy, iex - isx + 1, iey - isy + 1 );
+    fill_polygon_with( shadow, MaskPaint( shadow_mask ) );
+    shadow_mask.blur( radius, passes );
+    uint8_t *alphas = this->line_buffer;
+    const int n = iex - isx + 1;
+    for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+        const uint8_t *m = shadow_mask.row( iy );
+        for( int i = 0; i < n; i++ ){
+            alphas[i] = 128 - div255( ( 128 - alpha ) * m[i] );
         }
+        PixelFormat::blend_span( get_pointer_to_data_unsafe( isx, iy ), alphas, n, color );
     }
 }
+
+// 変換後のビットマップの外接矩形を描画範囲で切り取り、その中の画素だけを逆変換する。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class SrcFormat>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::blit( const Bitmap<SrcFormat> &src, const Affine2D &transform, const BLIT_FILTER filter, const uint8_t alpha ){
+    Affine2D inv;
+    if( alpha >= 128 || src.width <= 0 || src.height <= 0 || !transform.inverse( inv ) ){
+        return;
+    }
+    // The nearest pixel is sampled in [-0.5, width - 0.5), and the bilinear filter reaches 0.5 pixels more.
+    // 最近傍は[-0.5, width - 0.5)、双線形はさらに0.5画素外まで
+    const float margin = ( filter == BILINEAR ) ? 1.0f : 0.5f;
+    const float corners[4][2] = {
+        { -margin, -margin },
+        { src.width - 1 + margin, -margin },
+        { -margin, src.height - 1 + margin },
+        { src.width - 1 + margin, src.height - 1 + margin }
+    };
+    float min_x, min_y, max_x, max_y;
+    transform.apply( corners[0][0], corners[0][1], min_x, min_y );
+    max_x = min_x;
+    max_y = min_y;
+    for( int k = 1; k < 4; k++ ){
+        float x, y;
+        transform.apply( corners[k][0], corners[k][1], x, y );
+        if( min_x > x ) min_x = x;
+        if( max_x < x ) max_x = x;
+        if( min_y > y ) min_y = y;
+        if( max_y < y ) max_y = y;
+    }
+    if( max_x < this->clip_x0 || min_x > this->clip_x1 || max_y < this->clip_y0 || min_y > this->clip_y1 ){
+        this->n_culled_primitives++;
+        return;
+    }
+    // limited before the conversion to pixel_index_t / 整数に変換する前に制限
+    pixel_index_t isx = ( min_x < this->clip_x0 ) ? this->clip_x0 : static_cast<pixel_index_t>( floor( min_x ) );
+    pixel_index_t iex = ( max_x > this->clip_x1 ) ? this->clip_x1 : static_cast<pixel_index_t>( ceil( max_x ) );
+    pixel_index_t isy = ( min_y < this->clip_y0 ) ? this->clip_y0 : static_cast<pixel_index_t>( floor( min_y ) );
+    pixel_index_t iey = ( max_y > this->clip_y1 ) ? this->clip_y1 : static_cast<pixel_index_t>( ceil( max_y ) );
+
+    const int32_t du = lroundf( inv.a * 65536.0f );
+    const int32_t dv = lroundf( inv.c * 65536.0f );
+    for( pixel_index_t iy = isy; iy <= iey; iy++ ){
+        // the first pixel of the row is computed in float, so the error does not grow over the rows
+        // 行の先頭は浮動小数点で求めるので、誤差は行をまたいで蓄積しない
+        float u0, v0;
+        inv.apply( isx, iy, u0, v0 );
+        // the pixels of the row mapped into the bitmap (with 1 pixel of margin for the rounding)
+        // 転送元に対応する画素の範囲(丸めの分、1画素広くとる)
+        int i0 = 0;
+        int i1 = iex - isx;
+        narrow_blit_range( u0, inv.a, -margin, src.width - 1 + margin, i0, i1 );
+        narrow_blit_range( v0, inv.c, -margin, src.height - 1 + margin, i0, i1 );
+        if( i0 > i1 ){
+            continue;
+        }
+        int32_t u = lroundf( ( u0 + inv.a * i0 ) * 65536.0f );
+        int32_t v = lroundf( ( v0 + inv.c * i0 ) * 65536.0f );
+        Pointer ppixel = get_pointer_to_data_unsafe( isx + i0, iy );
+        if( filter == BILINEAR ){
+            blit_row_bilinear( src, u, v, du, dv, ppixel, i1 - i0 + 1, alpha );
+        }else{
+            blit_row_nearest( src, u, v, du, dv, ppixel, i1 - i0 + 1, alpha );
+        }
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class SrcFormat>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::blit_row_nearest( const Bitmap<SrcFormat> &src, int32_t u, int32_t v, const int32_t du, const int32_t dv, Pointer ppixel, const int n, const uint8_t alpha ){
+    typename SrcFormat::Color src_color;
+    Color color;
+    for( int i = 0; i < n; i++, u += du, v += dv, ppixel = PixelFormat::advance( ppixel, 1 ) ){
+        // round to the nearest pixel / 最も近い画素
+        int32_t iu = ( u + 0x8000 ) >> 16;
+        int32_t iv = ( v + 0x8000 ) >> 16;
+        if( static_cast<uint32_t>( iu ) >= static_cast<uint32_t>( src.width ) || static_cast<uint32_t>( iv ) >= static_cast<uint32_t>( src.height ) ){
+            continue;
+        }
+        SrcFormat::get_Color( src.get_pointer_to_data( iu, iv ), src_color );
+        if( !src.is_opaque( src_color ) ){
+            continue;
+        }
+        ColorConverter<SrcFormat, PixelFormat>::convert( src_color, color );
+        blend_pixel( ppixel, color, alpha );
+    }
+}
+
+// 周囲2x2画素を距離で重み付けする。転送元の外とカラーキーの画素は透明として扱い、その重みの分だけalphaを上げる(境界のアンチエイリアス)。
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class SrcFormat>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::blit_row_bilinear( const Bitmap<SrcFormat> &src, int32_t u, int32_t v, const int32_t du, const int32_t dv, Pointer ppixel, const int n, const uint8_t alpha ){
+    typedef typename SrcFormat::Color SrcColor;
+    typedef typename FilterColor<SrcFormat>::Color TapColor;
+    static const int n_color = TapColor::n_color;
+    SrcColor taps[4];
+    TapColor tap;
+    Color color;
+    for( int i = 0; i < n; i++, u += du, v += dv, ppixel = PixelFormat::advance( ppixel, 1 ) ){
+        int32_t iu = u >> 16;
+        int32_t iv = v >> 16;
+        // 8-bit fractions, the weights of the 4 pixels sum to 65536 / 8bitの端数。4画素の重みの和は65536
+        uint32_t fu = ( u >> 8 ) & 0xFF;
+        uint32_t fv = ( v >> 8 ) & 0xFF;
+        uint32_t weights[4] = {
+            ( 256 - fu ) * ( 256 - fv ), fu * ( 256 - fv ),
+            ( 256 - fu ) * fv,           fu * fv
+        };
+        // all 4 pixels in the bitmap / 4画素とも転送元の内側
+        bool inside = static_cast<uint32_t>( iu ) < static_cast<uint32_t>( src.width - 1 ) && static_cast<uint32_t>( iv ) < static_cast<uint32_t>( src.height - 1 );
+        uint32_t covered = 0;
+        uint32_t sum[ n_color ] = {};
+        for( int k = 0; k < 4; k++ ){
+            int32_t tu = iu + ( k & 1 );
+            int32_t tv = iv + ( k >> 1 );
+            if( weights[k] == 0 ){
+                continue;
+            }
+            if( !inside && ( static_cast<uint32_t>( tu ) >= static_cast<uint32_t>( src.width ) || static_cast<uint32_t>( tv ) >= static_cast<uint32_t>( src.height ) ) ){
+                continue;
+            }
+            SrcFormat::get_Color( src.get_pointer_to_data( tu, tv ), taps[k] );
+            if( !src.is_opaque( taps[k] ) ){
+                continue;
+            }
+            FilterColor<SrcFormat>::expand( taps[k], tap );
+            for( int c = 0; c < n_color; c++ ){
+                sum[c] += tap.color[c] * weights[k];
+            }
+            covered += weights[k];
+        }
+        if( covered == 0 ){
+            continue;
+        }
+        TapColor src_color;
+        uint8_t a = alpha;
+        if( covered == 65536 ){
+            for( int c = 0; c < n_color; c++ ){
+                src_color.color[c] = ( sum[c] + 32768 ) >> 16;
+            }
+        }else{
+            // partly transparent: the average of the opaque pixels with the coverage / 一部が透明
+            for( int c = 0; c < n_color; c++ ){
+                src_color.color[c] = ( sum[c] + covered / 2 ) / covered;
+            }
+            a = 128 - ( ( ( 128 - alpha ) * covered ) >> 16 );
+            if( a >= 128 ){
+                continue;
+            }
+        }
+        FilterColor<SrcFormat>::template convert<PixelFormat>( src_color, color );
+        blend_pixel( ppixel, color, a );
+    }
+}
+
 /*
 void draw_circle( const float cx, const float cy, const float radius, const float weight, Color &color, const uint8_t alpha = 0U ){
 
@@ -506,8 +1567,26 @@ void draw_circle( const float cx, const float cy, const float radius, const floa
 */
 
 
-template <unsigned int WIDTH, unsigned int HEIGHT, unsigned int BYTES_PER_PIXEL, class Color> 
-bool Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::saveBMP(std::string file_name){
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+template <class DstFormat>
+void Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::convert_rows( const int y0, const int n_rows, uint8_t *dst ){
+    Color color;
+    typename DstFormat::Color dst_color;
+    for( int r = 0; r < n_rows; r++ ){
+        Pointer ppixel = get_pointer_to_data_unsafe( 0, y0 + r );
+        typename DstFormat::Pointer pdst = DstFormat::pixel_pointer( dst + r * DstFormat::row_bytes( width ), 0, y0 + r );
+        for( int x = 0; x < width; x++ ){
+            get_Color( ppixel, color );
+            ColorConverter<PixelFormat, DstFormat>::convert( color, dst_color );
+            DstFormat::set_Color( pdst, dst_color );
+            ppixel = PixelFormat::advance( ppixel, 1 );
+            pdst = DstFormat::advance( pdst, 1 );
+        }
+    }
+}
+
+template <unsigned int WIDTH, unsigned int HEIGHT, class PixelFormat, class SamplingPattern> 
+bool Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern> ::saveBMP(std::string file_name){
 
 #ifndef ESP32
     std::ofstream fout( file_name, std::ios::binary );
@@ -515,7 +1594,9 @@ bool Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::saveBMP(std::string file_na
     // BITMAPFILEHEADER 14 bytes
     char bfType[2] = {'B','M'};
     fout.write(bfType,2);
-    unsigned int file_size = width * height * 3 + 54;
+    const int bmp_bytes_per_pixel = ( PixelFormat::bmp_bit_count != 0 ) ? PixelFormat::bmp_bit_count / 8 : 3;
+    const int n_padding = ( 4 - ( width * bmp_bytes_per_pixel ) % 4 ) % 4;
+    unsigned int file_size = ( width * bmp_bytes_per_pixel + n_padding ) * height + 54;
     fout.write(reinterpret_cast<char *>(&file_size),4); // bfSize
     unsigned short s_zero = 0;
     fout.write(reinterpret_cast<char *>(&s_zero),2); // bfReserved1
@@ -531,7 +1612,7 @@ bool Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::saveBMP(std::string file_na
     fout.write(reinterpret_cast<char *>(&bcHeight),4); // bcHeight
     unsigned short bcPlanes = 1;
     fout.write(reinterpret_cast<char *>(&bcPlanes),2); // bcPlanes
-    unsigned short bcBitCount = 24;
+    unsigned short bcBitCount = bmp_bytes_per_pixel * 8;
     fout.write(reinterpret_cast<char *>(&bcBitCount),2); // bcBitCount
     unsigned int biCompression = 0;
     fout.write(reinterpret_cast<char *>(&biCompression),4); // biCompression
@@ -545,24 +1626,25 @@ bool Canvas<WIDTH, HEIGHT, BYTES_PER_PIXEL, Color> ::saveBMP(std::string file_na
     fout.write(reinterpret_cast<char *>(&i_zero),4); // biCompression
 
     // DATA
-    Color color;     // original data
-    uint8_t r8, g8, b8;  // converted data
+    // The rows of the formats in the order of BMP (bmp_bit_count != 0) are written directly,
+    // the others are converted to B, G, R row by row. / BMPと同じ並びの形式は変換せずに書き込む
+    const int bmp_row_bytes = width * bmp_bytes_per_pixel;
+    const char padding[4] = { 0, 0, 0, 0 };
+    std::vector<uint8_t> row( bmp_row_bytes );
     for( int h = 0; h < height; h++ ){
-        uint8_t* p_data = get_pointer_to_data_unsafe( 0, h );
-        for( int w = 0; w < width; w++ ){
-            get_Color( p_data, color );
-            Color_to_RGB888( color, r8, g8, b8 );
-            fout.write(reinterpret_cast<char *>(&b8),1); // 
-            fout.write(reinterpret_cast<char *>(&g8),1); // 
-            fout.write(reinterpret_cast<char *>(&r8),1); // 
-            p_data += bytes_per_pixel;
-        }
-        // padding 
-        int n_padding = (( 4 - (3 * width) & 0x3 ) & 0x3);
-        char dummy = 0;
-        for( int n = 0; n < n_padding; n++ ){
-            fout.write( &dummy, 1 ); // 
+        if( PixelFormat::bmp_bit_count != 0 ){
+            fout.write( reinterpret_cast<char *>( &this->data[ h * row_bytes ] ), bmp_row_bytes );
+        }else{
+            Pointer p_data = get_pointer_to_data_unsafe( 0, h );
+            Color color;
+            for( int w = 0; w < width; w++ ){
+                get_Color( p_data, color );
+                Color_to_RGB888( color, row[ w * 3 + 2 ], row[ w * 3 + 1 ], row[ w * 3 ] );
+                p_data = PixelFormat::advance( p_data, 1 );
+            }
+            fout.write( reinterpret_cast<char *>( &row[0] ), bmp_row_bytes );
         }
+        fout.write( padding, n_padding );
     }    
     fout.close();
 
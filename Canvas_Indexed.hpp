@@ -0,0 +1,19 @@
+#ifndef __CANVAS_INDEXED_HPP__
+#define __CANVAS_INDEXED_HPP__
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+#include "Palette.hpp"
+
+// BITS (4 or 8) bits per pixel, the index of a color of the palette. 1/4 (4 bits) or 1/2 (8 bits) of the memory of RGB565.
+// The palette is set by PixelFormat::set_palette() before drawing, and the colors are given by ColorIndex.
+// Send it to an RGB565 display by convert_rows<PixelFormat_RGB565>() in bands.
+// The blends use the blend table of the palette up to 32 colors (17 KB). 8 bits with more colors saves the
+// memory of the canvas, but each blended pixel searches the nearest color of the palette (see Palette).
+// パレットの色番号を4bitまたは8bitで持つ。描画前にPixelFormat::set_palette()でパレットを設定する。
+template < unsigned int WIDTH, unsigned int HEIGHT, uint8_t BITS = 4, class SamplingPattern = DefaultSamplingPattern, class PixelFormat = PixelFormatIndexed<BITS> >
+class Canvas_Indexed : public Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern >{
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __CANVAS_MONO_HPP__
+#define __CANVAS_MONO_HPP__
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+
+// 1 bit per pixel, 8 pixels in a byte (e-paper, monochrome LCD/OLED). 1/16 of the frame memory of RGB565 (the canvas also has two row buffers of width bytes).
+// Colors are converted to black and white by an ordered dither. The left most pixel is in the MSB.
+// 1画素1bitの白黒。色は組織的ディザで2値化する。
+// The other bit order (PixelFormat_Mono_LSB) can be given by PixelFormat.
+template < unsigned int WIDTH, unsigned int HEIGHT, class SamplingPattern = DefaultSamplingPattern, class PixelFormat = PixelFormat_Mono >
+class Canvas_Mono : public Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern >{
+};
+
+#endif
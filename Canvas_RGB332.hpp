@@ -0,0 +1,49 @@
+#ifndef __CANVAS_RGB332_HPP__
+#define __CANVAS_RGB332_HPP__
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+#include "Bitmap.hpp"
+
+// RRRGGGBB, 1 byte per pixel (the 256-color mode of SSD1331). Half of the data of RGB565 to send.
+// dither_from() converts an image of more colors (e.g. a Canvas_RGB565) with a 4x4 ordered dither.
+// 1画素1バイト(SSD1331の256色モード)。dither_from()で組織的ディザをかけて変換する。
+template < unsigned int WIDTH, unsigned int HEIGHT, class SamplingPattern = DefaultSamplingPattern, class PixelFormat = PixelFormat_RGB332 >
+class Canvas_RGB332 : public Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern >{
+    public:
+    typedef typename PixelFormat::Color Color;
+
+    // Convert src to this canvas with the ordered dither (e.g. canvas.get_bitmap()).
+    // The pixels out of src are not changed. / 組織的ディザで変換する
+    template <class SrcFormat>
+    void dither_from( const Bitmap<SrcFormat> &src ){
+        dither( src, this->get_pointer_to_data() );
+    }
+    // Same as dither_from, but into dst of WIDTH x HEIGHT bytes instead of a canvas (e.g. a frame to send to the display).
+    // キャンバスでなくWIDTH x HEIGHTバイトの領域に変換する(表示器に送るフレームなど)
+    template <class SrcFormat>
+    static void dither( const Bitmap<SrcFormat> &src, uint8_t *dst ){
+        const int w = ( src.width < (int)WIDTH ) ? src.width : WIDTH;
+        const int h = ( src.height < (int)HEIGHT ) ? src.height : HEIGHT;
+        typename SrcFormat::Color src_color;
+        Color color;
+        uint8_t r8, g8, b8;
+        for( int y = 0; y < h; y++ ){
+            typename SrcFormat::Pointer psrc = src.get_pointer_to_data( 0, y );
+            uint8_t *ppixel = dst + y * PixelFormat::row_bytes( WIDTH );
+            for( int x = 0; x < w; x++ ){
+                SrcFormat::get_Color( psrc, src_color );
+                SrcFormat::Color_to_RGB888( src_color, r8, g8, b8 );
+                color.color[0] = OrderedDither::template quantize<PixelFormat::r_bits>( r8, x, y );
+                color.color[1] = OrderedDither::template quantize<PixelFormat::g_bits>( g8, x, y );
+                color.color[2] = OrderedDither::template quantize<PixelFormat::b_bits>( b8, x, y );
+                PixelFormat::set_Color( ppixel, color );
+                psrc = SrcFormat::advance( psrc, 1 );
+                ppixel++;
+            }
+        }
+    }
+};
+
+#endif
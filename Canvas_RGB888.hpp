@@ -0,0 +1,23 @@
+#ifndef __CANVAS_RGB888_HPP__
+#define __CANVAS_RGB888_HPP__
+
+#include "Canvas.hpp"
+#include "Color.hpp"
+#include "PixelFormat.hpp"
+
+// 8 bits per channel for the host side rendering (previews, exports). No quantization to 565.
+// ホスト側での描画用(プレビュー、書き出し)。565に量子化しない
+// BBBBBBBB GGGGGGGG RRRRRRRR (the order of BMP files, saveBMP writes the rows without conversion)
+// The other orders (PixelFormat_BGR888) can be given by PixelFormat.
+template < unsigned int WIDTH, unsigned int HEIGHT, class SamplingPattern = DefaultSamplingPattern, class PixelFormat = PixelFormat_RGB888 >
+class Canvas_RGB888 : public Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern >{
+};
+
+// BBBBBBBB GGGGGGGG RRRRRRRR XXXXXXXX
+// Each pixel is on a 4-byte boundary, and blended two channels at a time in a 32-bit word.
+// 画素が4バイト境界に揃い、32bit単位で合成する
+template < unsigned int WIDTH, unsigned int HEIGHT, class SamplingPattern = DefaultSamplingPattern, class PixelFormat = PixelFormat_XRGB8888 >
+class Canvas_XRGB8888 : public Canvas<WIDTH, HEIGHT, PixelFormat, SamplingPattern >{
+};
+
+#endif
@@ -2,7 +2,10 @@
 #define __CANVAS_SSD1331_HPP__
 
 #include "Canvas_RGB565.hpp"
+#include "Canvas_RGB332.hpp"
 
 class Canvas_SSD1331 : public Canvas_RGB565<96,64>{};
+// the 256-color mode (DisplayController::COLOR_256 dithers the canvas by Canvas_SSD1331_256::dither) / 256色モードの形式
+class Canvas_SSD1331_256 : public Canvas_RGB332<96,64>{};
 
 #endif
\ No newline at end of file
@@ -10,6 +10,17 @@ const unsigned char n_canvas = 2;
 unsigned char current_canvas;
 Canvas_SSD1331 canvas[n_canvas];
 
+// Temporaries of the drawing (reset after each frame) / 描画の一時データ
+// The clock does not need it (the high water mark is 0: its polygons are small and inside of the canvas).
+// Define USE_DRAWING_ARENA when the drawing clips large polygons or uses draw_polygon_HQ, and size the buffer
+// from the high water mark printed by loop(). 時計には不要。大きなポリゴンを描く場合に定義し、最大使用量から大きさを決める
+//#define USE_DRAWING_ARENA
+#ifdef USE_DRAWING_ARENA
+#include "FrameArena.hpp"
+uint8_t drawing_arena_buffer[1024];
+FrameArena drawing_arena( drawing_arena_buffer, sizeof( drawing_arena_buffer ) );
+#endif
+
 // WiFi
 #include <WiFi.h>
 #include "wifi_setting.h"  // This file must be modified.
@@ -49,6 +60,11 @@ void setup() {
   Serial.begin(115200);  
 
   drawer.init();
+#ifdef USE_DRAWING_ARENA
+  for( int n = 0; n < n_canvas; n++ ){
+    canvas[n].set_frame_arena( &drawing_arena );
+  }
+#endif
 
   Serial.println("Display.setup()");
   // 黒画像スタート
@@ -74,11 +90,20 @@ void loop() {
   timer.get_hms(hour,min,second);
   //Serial.println(second);
   drawer.draw_clock( canvas[current_canvas], hour, min, second );
+#ifdef USE_DRAWING_ARENA
+  drawing_arena.reset();
+#endif
   current_canvas = ( current_canvas + 1 ) % n_canvas;
 
   if( millis() - t0 > 1000 ){
     t0 = millis();
     Serial.println(count);
+#ifdef USE_DRAWING_ARENA
+    Serial.print("arena high water mark: ");
+    Serial.print(drawing_arena.get_high_water_mark());
+    Serial.print(", failures: ");
+    Serial.println(drawing_arena.get_n_failures());
+#endif
     count = 0;
   }else{
     count++;
@@ -25,11 +25,10 @@ void Drawer::init(){
     ColoredPolygon2D frame;
     Polygon2D temp;
     Point2D center(48,32);
+    // ring: outer and inner circles as two contours / 外周と内周の2つの輪郭
     frame.polygon.circle24( center, 30 );
-    frame.polygon.add_Point2D( frame.polygon.get_Point2D(0));
     temp.circle24(center, 28 );
-    temp.add_Point2D(temp.get_Point2D(0));
-    frame.polygon.concat_inversely( temp );
+    frame.polygon.add_contour( temp, true );
     frame.face_color = this->color_dial;
     frame.alpha = 0;
     this->dial.addColoredPolygon(frame);
@@ -48,10 +47,7 @@ void Drawer::init(){
     }
 
     
-    uint8_t np = this->dial.p.size();
-    for( int p = 0; p < np; p++ ){
-        canvas_with_dial.fill_polygon( this->dial.p[p] );
-    }
+    canvas_with_dial.fill_picture( this->dial );
 
 
 }
@@ -67,13 +63,16 @@ void Drawer::draw_clock( Canvas_SSD1331 &canvas, int hour, int min, float second
         float deg_minute_hand = min * 6 + second * 0.1f;
         float deg_second_hand = second * 6.0f;
         Point2D center(48,32);
-        Polygon2D h = hour_hand.rotate( deg_hour_hand, center );
-        Polygon2D m = minute_hand.rotate( deg_minute_hand, center );
-        Polygon2D s = second_hand.rotate( deg_second_hand, center );
-
-        canvas.fill_polygon( h, const_cast<ColorRGB&>(color_hour_hand), 0);
-        canvas.fill_polygon( m, const_cast<ColorRGB&>(color_minute_hand), 0);
-        canvas.fill_polygon( s, const_cast<ColorRGB&>(color_second_hand), 0);
+        rotated_hour_hand = hour_hand;
+        rotated_hour_hand.rotate_equal( deg_hour_hand, center );
+        rotated_minute_hand = minute_hand;
+        rotated_minute_hand.rotate_equal( deg_minute_hand, center );
+        rotated_second_hand = second_hand;
+        rotated_second_hand.rotate_equal( deg_second_hand, center );
+
+        canvas.fill_polygon( rotated_hour_hand, const_cast<ColorRGB&>(color_hour_hand), 0);
+        canvas.fill_polygon( rotated_minute_hand, const_cast<ColorRGB&>(color_minute_hand), 0);
+        canvas.fill_polygon( rotated_second_hand, const_cast<ColorRGB&>(color_second_hand), 0);
 
         canvas.set_readable();
     }
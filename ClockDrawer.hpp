@@ -17,6 +17,10 @@ class Drawer{
     Polygon2D hour_hand;
     Polygon2D minute_hand;
     Polygon2D second_hand;
+    // the hands of the frame. Kept so that their edge tables are reused / 描画する針(辺テーブルの領域を使い回す)
+    Polygon2D rotated_hour_hand;
+    Polygon2D rotated_minute_hand;
+    Polygon2D rotated_second_hand;
 
     static const ColorRGB color_dial;
     static const ColorRGB color_hour_hand;
@@ -37,6 +37,14 @@ class ColorGray : public Color<1>{
     }
 };
 
+// Index of a color in a Palette (the Color of the indexed pixel formats) / パレットの色番号
+class ColorIndex : public Color<1>{
+    public:
+    ColorIndex( const color_t index = 0 ){
+        this->color[0] = index;
+    }
+};
+
 class ColorRGB : public Color<3>{
     public:
     ColorRGB( const color_t r = 0, const color_t g = 0, const color_t b = 0 ){
@@ -45,3 +53,21 @@ class ColorRGB : public Color<3>{
         this->color[2] = b;
     }
 };
+
+
+// 8-bit RGBA with premultiplied alpha. alpha = 255 is opaque and alpha = 0 is transparent
+// (the opposite of the 7-bit alpha of Canvas). Each color channel is already multiplied by alpha / 255.
+// 乗算済みアルファの8bit RGBA。alpha = 255が不透明(Canvasの7bit alphaとは逆)。
+class ColorRGBA8 : public Color<4>{
+    public:
+    ColorRGBA8( const color_t r = 0, const color_t g = 0, const color_t b = 0, const color_t a = 255 ){
+        this->color[0] = r;
+        this->color[1] = g;
+        this->color[2] = b;
+        this->color[3] = a;
+    }
+    // From a straight (not premultiplied) color / 乗算済みでない色から作る
+    static ColorRGBA8 from_straight( const color_t r, const color_t g, const color_t b, const color_t a ){
+        return ColorRGBA8( ( r * a + 127 ) / 255, ( g * a + 127 ) / 255, ( b * a + 127 ) / 255, a );
+    }
+};
@@ -3,6 +3,7 @@
 
 #include "Polygon2D.hpp"
 #include "Color.hpp"
+#include "Gradient.hpp"
 
 class ColoredPolygon2D{
 
@@ -13,6 +14,9 @@ class ColoredPolygon2D{
     Polygon2D polygon;
     ColorRGB face_color;
     uint8_t alpha;
+    // If not NULL, the polygon is filled by the gradient instead of face_color. Not owned.
+    // NULLでなければface_colorの代わりにグラデーションで塗る(所有しない)
+    const Gradient *gradient;
 
     public:
     //================
@@ -34,6 +38,10 @@ class ColoredPolygon2D{
         this->face_color.color[2] = b;
         this->alpha = alpha;
     }
+    inline void set_gradient( const Gradient *gradient, const uint8_t alpha = 0 ){
+        this->gradient = gradient;
+        this->alpha = alpha;
+    }
 };
 
 #endif
\ No newline at end of file
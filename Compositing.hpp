@@ -0,0 +1,264 @@
+#ifndef __COMPOSITING_HPP__
+#define __COMPOSITING_HPP__
+/*==============================================================//
+Compositing
+    How the drawing functions of Canvas write a color to the pixels.
+    描画関数が画素に色を書き込む方法
+
+    A paint is given to the rasterizing functions of Canvas as a template
+    parameter, so its span functions are specialized at compile time.
+        template <class Coverage>
+        void covered_span( Pointer p_data, const pixel_index_t x, const pixel_index_t y, const typename Coverage::coverage_t *areas, const int n ) const;
+                                    : n pixels partly covered (areas)
+        void full_span( Pointer p_data, const pixel_index_t x, const pixel_index_t y, const int n ) const;
+                                    : n pixels fully covered
+    p_data (PixelFormat::Pointer) points to the pixel (x, y).
+
+    - AlphaPaint
+      The 7-bit alpha of Canvas (0: opaque, 128: transparent), source-over.
+    - PremultipliedPaint<Op>
+      8-bit premultiplied color (ColorRGBA8) composited by the Porter-Duff
+      operator Op: CompositeSrcOver, CompositeAdd, CompositeMultiply or
+      CompositeSrc. The coverage is converted to 8 bits by a table
+      (CoverageTable), not by a divide.
+      The canvas has no alpha channel, so the destination is opaque.
+      The pixels are expanded to 8 bits by PixelFormat::Color_to_RGB888,
+      composited, and truncated by PixelFormat::RGB888_to_Color.
+    - GradientPaint
+      The colors of a Gradient with the 7-bit alpha, source-over.
+      The colors of a span are shaded by Gradient::shade_span in chunks.
+    - MaskPaint
+      Writes the 8-bit coverage to an AlphaMask instead of the pixels
+      (the shadows of Canvas::draw_shadow).
+
+    ポリゴンの描画関数にテンプレート引数で渡すので、合成処理はコンパイル時に特殊化される。
+//==============================================================*/
+#include "Color.hpp"
+#include "Gradient.hpp"
+#include "AlphaMask.hpp"
+#include "resolution.hpp"
+#include <stdint.h>
+#include <string.h>
+
+// x / 255 rounded, for x in [0, 255 * 255] / 255での除算(四捨五入)
+static inline uint8_t div255( const uint16_t x ){
+    return ( x + 128 + ( ( x + 128 ) >> 8 ) ) >> 8;
+}
+
+//================
+// Porter-Duff operators / 合成演算子
+//================
+// d: destination channel, s: source channel (premultiplied), sa: source alpha.
+// s and sa are already multiplied by the coverage c.
+// d: 書き込み先, s: 元の色(乗算済み), sa: 元のalpha。s, saは被覆cを掛けた値
+struct CompositeSrcOver{
+    // s + d * ( 1 - sa )
+    static inline uint8_t apply( const uint8_t d, const uint8_t s, const uint8_t sa, const uint8_t ){
+        return s + div255( d * ( 255 - sa ) );
+    }
+};
+struct CompositeAdd{
+    // min( s + d, 1 ), for glows / 加算(光の表現)
+    static inline uint8_t apply( const uint8_t d, const uint8_t s, const uint8_t, const uint8_t ){
+        uint16_t v = d + s;
+        return ( v > 255 ) ? 255 : v;
+    }
+};
+struct CompositeMultiply{
+    // s * d + d * ( 1 - sa ), for shadows / 乗算(影の表現)
+    static inline uint8_t apply( const uint8_t d, const uint8_t s, const uint8_t sa, const uint8_t ){
+        return div255( s * d ) + div255( d * ( 255 - sa ) );
+    }
+};
+struct CompositeSrc{
+    // s (the destination is replaced where covered) / 上書き。被覆の外側だけ元の画素が残る
+    static inline uint8_t apply( const uint8_t d, const uint8_t s, const uint8_t, const uint8_t c ){
+        return s + div255( d * ( 255 - c ) );
+    }
+};
+
+//================
+// Coverage to 8 bits / 被覆を8bitに変換
+//================
+// table[count] = count * 255 / Coverage::n_samples (rounded), built once for each Coverage.
+template <class Coverage>
+class CoverageTable{
+    public:
+    static inline uint8_t to_8bit( const typename Coverage::coverage_t area ){
+        return table()[ Coverage::count( area ) ];
+    }
+    private:
+    struct Table{
+        uint8_t v[ Coverage::n_samples + 1 ];
+        Table(){
+            for( uint16_t k = 0; k <= Coverage::n_samples; k++ ){
+                v[k] = ( k * 255 + Coverage::n_samples / 2 ) / Coverage::n_samples;
+            }
+        }
+    };
+    static inline const uint8_t *table(){
+        static const Table t;
+        return t.v;
+    }
+};
+
+//================
+// Paints / 塗り方
+//================
+// The 7-bit alpha of Canvas, source-over. / Canvasの7bit alpha (0: 不透明, 128: 透明)
+template <class PixelFormat>
+class AlphaPaint{
+    public:
+    typedef typename PixelFormat::Color Color;
+    typedef typename PixelFormat::Pointer Pointer;
+    const Color &color;
+    const uint8_t alpha;
+    AlphaPaint( const Color &color, const uint8_t alpha ) : color( color ), alpha( alpha ){}
+
+    // Alpha of the pixel covered by Coverage::count(area) / Coverage::n_samples / 被覆から合成のalpha
+    // n_samples is a constant, so the divide is compiled to a multiply and a shift.
+    template <class Coverage>
+    static inline uint8_t covered_alpha( const typename Coverage::coverage_t area, const uint8_t alpha ){
+        return 128 - ( 128 - alpha ) * Coverage::count( area ) / Coverage::n_samples;
+    }
+    // The alphas are converted in chunks on the stack (Canvas::fill_tile calls this from several threads).
+    template <class Coverage>
+    inline void covered_span( Pointer p_data, const pixel_index_t, const pixel_index_t, const typename Coverage::coverage_t *areas, const int n ) const{
+        static const int chunk = 32;
+        uint8_t alphas[ chunk ];
+        for( int i0 = 0; i0 < n; i0 += chunk ){
+            int m = ( n - i0 < chunk ) ? n - i0 : chunk;
+            for( int i = 0; i < m; i++ ){
+                alphas[i] = covered_alpha<Coverage>( areas[i0+i], this->alpha );
+            }
+            PixelFormat::blend_span( p_data, alphas, m, this->color );
+            p_data = PixelFormat::advance( p_data, m );
+        }
+    }
+    inline void full_span( Pointer p_data, const pixel_index_t, const pixel_index_t, const int n ) const{
+        PixelFormat::blend_span( p_data, n, this->color, this->alpha );
+    }
+};
+
+// The colors of the gradient with the 7-bit alpha of Canvas / グラデーションの色を7bit alphaで合成
+template <class PixelFormat>
+class GradientPaint{
+    public:
+    typedef typename PixelFormat::Color Color;
+    typedef typename PixelFormat::Pointer Pointer;
+    const Gradient &gradient;
+    const uint8_t alpha;
+    GradientPaint( const Gradient &gradient, const uint8_t alpha ) : gradient( gradient ), alpha( alpha ){}
+
+    template <class Coverage>
+    inline void covered_span( Pointer p_data, const pixel_index_t x, const pixel_index_t y, const typename Coverage::coverage_t *areas, const int n ) const{
+        ColorRGB colors[ chunk ];
+        Color color, org_color;
+        for( int i0 = 0; i0 < n; i0 += chunk ){
+            int m = ( n - i0 < chunk ) ? n - i0 : chunk;
+            this->gradient.shade_span( x + i0, y, m, colors );
+            for( int i = 0; i < m; i++ ){
+                uint8_t a = AlphaPaint<PixelFormat>::template covered_alpha<Coverage>( areas[i0+i], this->alpha );
+                if( a < 128 ){
+                    PixelFormat::ColorRGB_to_Color( colors[i], color );
+                    PixelFormat::get_Color( p_data, org_color );
+                    PixelFormat::alpha_blend( org_color, color, a, org_color );
+                    PixelFormat::set_Color( p_data, org_color );
+                }
+                p_data = PixelFormat::advance( p_data, 1 );
+            }
+        }
+    }
+    inline void full_span( Pointer p_data, const pixel_index_t x, const pixel_index_t y, const int n ) const{
+        ColorRGB colors[ chunk ];
+        Color color, org_color;
+        if( this->alpha >= 128 ){
+            return;
+        }
+        for( int i0 = 0; i0 < n; i0 += chunk ){
+            int m = ( n - i0 < chunk ) ? n - i0 : chunk;
+            this->gradient.shade_span( x + i0, y, m, colors );
+            for( int i = 0; i < m; i++ ){
+                PixelFormat::ColorRGB_to_Color( colors[i], color );
+                if( this->alpha == 0 ){
+                    PixelFormat::set_Color( p_data, color );
+                }else{
+                    PixelFormat::get_Color( p_data, org_color );
+                    PixelFormat::alpha_blend( org_color, color, this->alpha, org_color );
+                    PixelFormat::set_Color( p_data, org_color );
+                }
+                p_data = PixelFormat::advance( p_data, 1 );
+            }
+        }
+    }
+
+    private:
+    static const int chunk = 32;
+};
+
+// 8-bit premultiplied color composited by Op / 乗算済み8bitカラーをOpで合成
+template <class PixelFormat, class Op>
+class PremultipliedPaint{
+    public:
+    typedef typename PixelFormat::Color Color;
+    typedef typename PixelFormat::Pointer Pointer;
+    const ColorRGBA8 &color;
+    PremultipliedPaint( const ColorRGBA8 &color ) : color( color ){}
+
+    template <class Coverage>
+    inline void covered_span( Pointer p_data, const pixel_index_t, const pixel_index_t, const typename Coverage::coverage_t *areas, const int n ) const{
+        for( int i = 0; i < n; i++ ){
+            uint8_t c = CoverageTable<Coverage>::to_8bit( areas[i] );
+            if( c != 0 ){
+                composite( p_data, c );
+            }
+            p_data = PixelFormat::advance( p_data, 1 );
+        }
+    }
+    inline void full_span( Pointer p_data, const pixel_index_t, const pixel_index_t, const int n ) const{
+        for( int i = 0; i < n; i++ ){
+            composite( p_data, 255 );
+            p_data = PixelFormat::advance( p_data, 1 );
+        }
+    }
+
+    private:
+    // composite the color scaled by the coverage c / 被覆cを掛けた色を合成
+    inline void composite( Pointer p_data, const uint8_t c ) const{
+        uint8_t s[4];
+        for( int k = 0; k < 4; k++ ){
+            s[k] = ( c == 255 ) ? this->color.color[k] : div255( this->color.color[k] * c );
+        }
+        Color dst;
+        uint8_t d[3];
+        PixelFormat::get_Color( p_data, dst );
+        PixelFormat::Color_to_RGB888( dst, d[0], d[1], d[2] );
+        for( int k = 0; k < 3; k++ ){
+            d[k] = Op::apply( d[k], s[k], s[3], c );
+        }
+        PixelFormat::RGB888_to_Color( d[0], d[1], d[2], dst );
+        PixelFormat::set_Color( p_data, dst );
+    }
+};
+
+// The coverage of the polygon to the mask, the pixels are not changed / 被覆をマスクに書き込む(画素は変更しない)
+// The pixels must be in the mask. / 画素はマスクの内側であること
+class MaskPaint{
+    public:
+    AlphaMask &mask;
+    MaskPaint( AlphaMask &mask ) : mask( mask ){}
+
+    template <class Coverage, class Pointer>
+    inline void covered_span( Pointer, const pixel_index_t x, const pixel_index_t y, const typename Coverage::coverage_t *areas, const int n ) const{
+        uint8_t *m = this->mask.row( y ) + ( x - this->mask.x0 );
+        for( int i = 0; i < n; i++ ){
+            m[i] = CoverageTable<Coverage>::to_8bit( areas[i] );
+        }
+    }
+    template <class Pointer>
+    inline void full_span( Pointer, const pixel_index_t x, const pixel_index_t y, const int n ) const{
+        memset( this->mask.row( y ) + ( x - this->mask.x0 ), 255, n );
+    }
+};
+
+#endif
@@ -2,7 +2,7 @@
 #include "debug_functions.hpp"
 #include <Arduino.h>
 
-void DisplayController::setup( int pin_DCCntl, int pin_RST, int pin_CS, Canvas_SSD1331 *canvas, unsigned char n_canvas ){
+void DisplayController::setup( int pin_DCCntl, int pin_RST, int pin_CS, Canvas_SSD1331 *canvas, unsigned char n_canvas, bool use_color_256, FrameArena *arena ){
     if( n_canvas == 0 ){
         this->n_canvas = 1;
     }else{
@@ -18,7 +18,14 @@ void DisplayController::setup( int pin_DCCntl, int pin_RST, int pin_CS, Canvas_S
     }
     this->p_canvases[0]->clear();
     is_rotated = false;
+    this->color_mode = COLOR_65K;
+    this->requested_color_mode = COLOR_65K;
+    if( use_color_256 && this->frame_256 == NULL ){
+        this->frame_256 = new uint8_t[ frame_256_bytes ];
+    }
     this->display.init( pin_DCCntl, pin_RST, pin_CS ); // onにはしない。
+    this->arena = arena;
+    this->display.set_frame_arena( this->arena );
     this->display.send_frame_65K( (this->p_canvases[0]->get_pointer_to_data()) ); // 黒画像を送る。
     this->display.on();
 
@@ -46,14 +53,42 @@ void DisplayController::loop(){
     while (1){
         //Serial.print("*");
         if( this->p_canvases[d]->is_readable() ){
-            this->display.send_frame_65K( (this->p_canvases[d]->get_pointer_to_data()) );
+            apply_color_mode();
+            send_canvas( this->p_canvases[d] );
             this->p_canvases[d]->set_writable();
+            if( this->arena != NULL ){
+                this->arena->reset();
+            }
             d = ( d + 1 ) % this->n_canvas;
         }
         delay(2);
     }
 }
 
+// 色数の切り替え(フレームの送信の間に行う)
+void DisplayController::apply_color_mode(){
+    COLOR_MODE mode = this->requested_color_mode;
+    if( mode == this->color_mode ){
+        return;
+    }
+    if( mode == COLOR_256 && this->frame_256 == NULL ){
+        // not reserved by setup() / setupで確保していない
+        this->requested_color_mode = this->color_mode;
+        return;
+    }
+    this->display.set_color_depth( ( mode == COLOR_256 ) ? SSD1331::COLOR_DEPTH::COLOR_256 : SSD1331::COLOR_DEPTH::COLOR_65K );
+    this->color_mode = mode;
+}
+
+// 256色モードではRGB332に組織的ディザで変換して送る
+void DisplayController::send_canvas( Canvas_SSD1331 *canvas ){
+    if( this->color_mode == COLOR_256 ){
+        Canvas_SSD1331_256::dither( canvas->get_bitmap(), this->frame_256 );
+        this->display.send_frame( this->frame_256 );
+    }else{
+        this->display.send_frame_65K( canvas->get_pointer_to_data() );
+    }
+}
 
 void DisplayController::dim_mode(){
     display.dim_mode();
@@ -3,18 +3,45 @@
 
 #include "SSD1331.hpp"
 #include "Canvas_SSD1331.hpp"
+#include "FrameArena.hpp"
 class DisplayController{
 
+    public:
+    // 表示の色数
+    enum COLOR_MODE{
+        COLOR_65K, // send the canvas as it is (96x64x2 bytes)
+        COLOR_256, // dither the canvas to RGB332 and send 96x64x1 bytes (half of the SPI time)
+    };
+
     private:
     unsigned char n_canvas;
     Canvas_SSD1331* *p_canvases;
     SSD1331 display;
     unsigned char wait_mode;
     bool is_rotated;
+    COLOR_MODE color_mode;
+    volatile COLOR_MODE requested_color_mode; // set by set_color_mode(), applied by loop()
+    // the dithered frame of COLOR_256 (96x64 bytes), reserved by setup() if use_color_256 / 256色モードのフレーム(setupで確保)
+    static const size_t frame_256_bytes = 96 * 64;
+    uint8_t *frame_256;
+    // temporaries of the display task (partial transfers), given by the caller and reset after each frame / 表示タスクの一時データ
+    FrameArena *arena;
 
     public:
-    void setup( int pin_DCCntl, int pin_RST, int pin_CS, Canvas_SSD1331 *canvas, unsigned char n_canvas = 2 );
+    DisplayController() : frame_256( NULL ), arena( NULL ){}
+    // use_color_256: reserve the frame of COLOR_256 (6 KB), so that set_color_mode( COLOR_256 ) does not allocate while running
+    // arena: the buffers of the partial transfers of SSD1331 (send_partial_data*). Only for those: the frames are sent
+    // as they are, so leave it NULL unless the partial transfers are used (2 * 96 bytes per row sent at once).
+    // use_color_256: 256色モードのフレームを確保する(実行中に確保しないように)
+    // arena: 部分転送の一時領域。部分転送を使う場合だけ渡す(全体の転送には使わない)
+    void setup( int pin_DCCntl, int pin_RST, int pin_CS, Canvas_SSD1331 *canvas, unsigned char n_canvas = 2, bool use_color_256 = false, FrameArena *arena = NULL );
     void rotate();
+    // 色数の切り替え(setupの後)。次のフレームの送信前にloopで切り替える。
+    // COLOR_256 is ignored if setup() did not reserve its frame. / setupで確保していなければCOLOR_256は無視する
+    void set_color_mode( COLOR_MODE mode ){ this->requested_color_mode = mode; }
+    COLOR_MODE get_color_mode() const { return this->color_mode; }
+    // the arena given to setup() (NULL if none), for get_high_water_mark() / 表示タスクの一時データ領域
+    const FrameArena *get_frame_arena() const { return this->arena; }
     
     public:
     //static void static_loop(void*);
@@ -22,7 +49,10 @@ class DisplayController{
     void off();
     void dim_mode();
     void on();
-    
+
+    private:
+    void apply_color_mode();
+    void send_canvas( Canvas_SSD1331 *canvas );
 
 };
 #endif //__DEISPLAY_CONTROLLER_HPP
\ No newline at end of file
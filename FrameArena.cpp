@@ -0,0 +1,47 @@
+#include "FrameArena.hpp"
+#include <new>
+
+//================
+// constructor / コンストラクタ
+//================
+FrameArena::FrameArena( const size_t capacity ){
+    this->buffer = new( std::nothrow ) uint8_t[ capacity ];
+    this->n_capacity = ( this->buffer != NULL ) ? capacity : 0;
+    this->n_used = 0;
+    this->n_high_water_mark = 0;
+    this->n_failures = 0;
+    this->owns_buffer = true;
+}
+
+FrameArena::FrameArena( void *buffer, const size_t capacity ){
+    this->buffer = static_cast<uint8_t*>( buffer );
+    this->n_capacity = ( buffer != NULL ) ? capacity : 0;
+    this->n_used = 0;
+    this->n_high_water_mark = 0;
+    this->n_failures = 0;
+    this->owns_buffer = false;
+}
+
+FrameArena::~FrameArena(){
+    if( this->owns_buffer ){
+        delete [] this->buffer;
+    }
+}
+
+//================
+// Functions / 関数
+//================
+void *FrameArena::allocate( const size_t n_bytes, const size_t align ){
+    // align the address, not the offset (the buffer may not be aligned) / 番地で揃える
+    const uintptr_t top = reinterpret_cast<uintptr_t>( this->buffer ) + this->n_used;
+    const size_t offset = this->n_used + ( ( align - ( top & ( align - 1 ) ) ) & ( align - 1 ) );
+    if( offset > this->n_capacity || n_bytes > this->n_capacity - offset ){
+        this->n_failures++;
+        return NULL;
+    }
+    this->n_used = offset + n_bytes;
+    if( this->n_used > this->n_high_water_mark ){
+        this->n_high_water_mark = this->n_used;
+    }
+    return this->buffer + offset;
+}
@@ -0,0 +1,69 @@
+#ifndef __FRAME_ARENA_HPP__
+#define __FRAME_ARENA_HPP__
+/*==============================================================//
+class FrameArena
+    A bump allocator for the temporaries of a frame (outlines of
+    draw_polygon_HQ, clipped polygons, buffers of the rasterizers, the
+    data of a partial transfer to the display).
+    1フレーム内の一時データ用の領域。先頭から順に切り出し、フレームごとに
+    reset()でまとめて解放する。
+
+    allocate() only moves the offset, and reset() releases everything at
+    once, so the heap is not fragmented by the temporaries over long
+    runs. allocate() returns NULL when the arena is full, and the callers
+    fall back to the heap (or to a way without a buffer).
+    Memory from the arena must not be used after reset(). Not thread safe:
+    use one arena for each task (e.g. the drawing loop and the display task).
+    reset()後は使用不可。スレッドセーフではないのでタスクごとに持つ。
+//==============================================================*/
+#include <stddef.h>
+#include <stdint.h>
+
+class FrameArena{
+
+    //================
+    // variables
+    //================
+    private:
+    uint8_t *buffer;
+    size_t n_capacity;
+    size_t n_used;
+    size_t n_high_water_mark; // the maximum of n_used since reset_statistics() / 使用量の最大値
+    uint32_t n_failures;      // the number of allocate() returned NULL / 確保に失敗した回数
+    bool owns_buffer;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    // Allocate capacity bytes once / capacityバイトを1度だけ確保する
+    explicit FrameArena( const size_t capacity );
+    // Use the given buffer (e.g. a static array) / 与えた領域を使う
+    FrameArena( void *buffer, const size_t capacity );
+    ~FrameArena();
+    private:
+    FrameArena( const FrameArena & );
+    FrameArena &operator = ( const FrameArena & );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // n_bytes aligned by align (a power of 2), or NULL if the arena is full / 確保できなければNULL
+    void *allocate( const size_t n_bytes, const size_t align = sizeof( void* ) );
+    template <class T>
+    inline T *allocate_array( const size_t n ){
+        return static_cast<T*>( allocate( n * sizeof( T ), alignof( T ) ) );
+    }
+    // Release all memory of the arena. Call once per frame. / 全て解放する。フレームごとに呼ぶ
+    inline void reset(){ this->n_used = 0; }
+
+    inline size_t get_capacity() const { return this->n_capacity; }
+    inline size_t get_used() const { return this->n_used; }
+    // The peak of get_used(). If it reaches the capacity, make the arena larger. / 最大使用量
+    inline size_t get_high_water_mark() const { return this->n_high_water_mark; }
+    inline uint32_t get_n_failures() const { return this->n_failures; }
+    inline void reset_statistics(){ this->n_high_water_mark = this->n_used; this->n_failures = 0; }
+};
+
+#endif
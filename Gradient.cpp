@@ -0,0 +1,168 @@
+#include "Gradient.hpp"
+#include <math.h>
+
+//================
+// constructor / コンストラクタ
+//================
+Gradient::Gradient(){
+    this->type = LINEAR;
+    this->dtdx = 0;
+    this->dtdy = 0;
+    this->t0 = 0;
+    this->cx = 0;
+    this->cy = 0;
+    this->radius = 1;
+}
+
+Gradient Gradient::linear( const float x0, const float y0, const float x1, const float y1, const ColorRGB &c0, const ColorRGB &c1 ){
+    Gradient gradient;
+    gradient.set_linear( x0, y0, x1, y1 );
+    gradient.set_colors( c0, c1 );
+    return gradient;
+}
+
+Gradient Gradient::radial( const float cx, const float cy, const float radius, const ColorRGB &c0, const ColorRGB &c1 ){
+    Gradient gradient;
+    gradient.set_radial( cx, cy, radius );
+    gradient.set_colors( c0, c1 );
+    return gradient;
+}
+
+//================
+// Functions / 関数
+//================
+void Gradient::set_linear( const float x0, const float y0, const float x1, const float y1 ){
+    this->type = LINEAR;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float len2 = dx * dx + dy * dy;
+    if( len2 == 0 ){
+        // t = 1 everywhere / 全体が終端の色
+        this->dtdx = 0;
+        this->dtdy = 0;
+        this->t0 = 0x10000;
+        return;
+    }
+    // t = ( ( x - x0 ) * dx + ( y - y0 ) * dy ) / len2
+    this->dtdx = lroundf( dx / len2 * 65536.0f );
+    this->dtdy = lroundf( dy / len2 * 65536.0f );
+    this->t0 = lroundf( -( x0 * dx + y0 * dy ) / len2 * 65536.0f );
+}
+
+void Gradient::set_radial( const float cx, const float cy, const float radius ){
+    this->type = RADIAL;
+    this->cx = cx;
+    this->cy = cy;
+    // the deltas of t^2 overflow for a smaller radius / これより小さいと差分があふれる
+    this->radius = ( radius < 0.5f ) ? 0.5f : radius;
+}
+
+void Gradient::set_colors( const ColorRGB &c0, const ColorRGB &c1 ){
+    const ColorRGB colors[2] = { c0, c1 };
+    const float positions[2] = { 0.0f, 1.0f };
+    set_colors( colors, positions, 2 );
+}
+
+// ramp[i] is the color at t = ( i + 0.5 ) / n_ramp / ramp[i]はt = ( i + 0.5 ) / n_rampの色
+void Gradient::set_colors( const ColorRGB *colors, const float *positions, const int n ){
+    if( n <= 0 ){
+        return;
+    }
+    int k = 0;
+    for( int i = 0; i < n_ramp; i++ ){
+        float t = ( i + 0.5f ) / n_ramp;
+        while( k < n - 1 && positions[k+1] < t ){
+            k++;
+        }
+        if( t <= positions[0] ){
+            this->ramp[i] = colors[0];
+        }else if( k == n - 1 ){
+            this->ramp[i] = colors[n-1];
+        }else{
+            float f = ( t - positions[k] ) / ( positions[k+1] - positions[k] );
+            for( int c = 0; c < ColorRGB::n_color; c++ ){
+                this->ramp[i].color[c] = lroundf( colors[k].color[c] + ( colors[k+1].color[c] - colors[k].color[c] ) * f );
+            }
+        }
+    }
+}
+
+void Gradient::shade_span( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const{
+    if( this->type == LINEAR ){
+        shade_linear( x, y, n, colors );
+    }else{
+        shade_radial( x, y, n, colors );
+    }
+}
+
+void Gradient::shade_linear( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const{
+    // t of the first pixel. Far outside of [0, 1] is clamped to keep t in int32_t.
+    // 先頭画素のt。int32_tに収まるよう[0, 1]から遠い値は制限する
+    float t_start = ( static_cast<float>( this->dtdx ) * x + static_cast<float>( this->dtdy ) * y + this->t0 );
+    if( t_start < -1073741824.0f ) t_start = -1073741824.0f;
+    if( t_start > 1073741824.0f ) t_start = 1073741824.0f;
+    int32_t t = static_cast<int32_t>( t_start );
+    for( int i = 0; i < n; i++ ){
+        int32_t tc = ( t < 0 ) ? 0 : ( ( t > 0xFFFF ) ? 0xFFFF : t );
+        colors[i] = this->ramp[ tc >> 8 ];
+        t += this->dtdx;
+    }
+}
+
+void Gradient::shade_radial( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const{
+    const ColorRGB &outside = this->ramp[ n_ramp - 1 ];
+    // the pixels inside the circle: ( ix - cx )^2 < h2 / 円の内側の画素
+    float dy = y - this->cy;
+    float h2 = this->radius * this->radius - dy * dy;
+    int xs = x + n;
+    int xe = x + n - 1;
+    if( h2 > 0 ){
+        float h = sqrtf( h2 );
+        xs = static_cast<int>( floorf( this->cx - h ) ) + 1;
+        xe = static_cast<int>( ceilf( this->cx + h ) ) - 1;
+        if( xs < x ) xs = x;
+        if( xe > x + n - 1 ) xe = x + n - 1;
+        if( xs > xe ){
+            xs = x + n;
+            xe = x + n - 1;
+        }
+    }
+    int i = 0;
+    for( ; i < xs - x; i++ ){
+        colors[i] = outside;
+    }
+    if( xs <= xe ){
+        // g = t^2 * 2^24, dg = g( ix + 1 ) - g( ix ), ddg = dg( ix + 1 ) - dg( ix )
+        static const float one = 16777216.0f;
+        const float inv_r2 = one / ( this->radius * this->radius );
+        const float dx = xs - this->cx;
+        int32_t g = lroundf( ( dx * dx + dy * dy ) * inv_r2 );
+        int32_t dg = lroundf( ( 2.0f * dx + 1.0f ) * inv_r2 );
+        const int32_t ddg = lroundf( 2.0f * inv_r2 );
+        const uint8_t *sqrt_index = sqrt_table();
+        for( ; i <= xe - x; i++ ){
+            int32_t gc = ( g < 0 ) ? 0 : ( ( g > 0xFFFFFF ) ? 0xFFFFFF : g );
+            colors[i] = this->ramp[ sqrt_index[ gc >> 14 ] ];
+            g += dg;
+            dg += ddg;
+        }
+    }
+    for( ; i < n; i++ ){
+        colors[i] = outside;
+    }
+}
+
+// table[k] = index of the ramp for t^2 = ( k + 0.5 ) / n_sqrt, built once / t^2からrampの番号への表
+const uint8_t *Gradient::sqrt_table(){
+    struct Table{
+        uint8_t v[ n_sqrt ];
+        Table(){
+            for( int k = 0; k < n_sqrt; k++ ){
+                int i = static_cast<int>( sqrtf( ( k + 0.5f ) / n_sqrt ) * n_ramp );
+                v[k] = ( i > n_ramp - 1 ) ? n_ramp - 1 : i;
+            }
+        }
+    };
+    static const Table t;
+    return t.v;
+}
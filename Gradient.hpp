@@ -0,0 +1,80 @@
+#ifndef __GRADIENT_HPP__
+#define __GRADIENT_HPP__
+/*==============================================================//
+class Gradient
+    Linear or radial color gradient for filling polygons.
+    / ポリゴンを塗りつぶすための線形・放射グラデーション
+
+    The coordinates are the pixel coordinates of the canvas (the same as
+    Point2D; the center of the pixel (ix, iy) is (ix, iy)).
+    The colors are the colors of the canvas (e.g. 5, 6, 5 bits for RGB565).
+    They are interpolated to a ramp of n_ramp colors when they are set,
+    and the position t in [0, 1] picks a color of the ramp. Outside of
+    [0, 1], the end colors are used (pad).
+
+    A row of pixels is shaded incrementally by shade_span():
+      LINEAR : t is a 16.16 fixed point value, increased by a constant
+               per pixel.
+      RADIAL : t^2 is a fixed point value, increased by a delta that is
+               increased by a constant per pixel (second order difference).
+               t is looked up from t^2 by a table of n_sqrt entries.
+               Only the pixels inside the circle are evaluated; the
+               others take the last color.
+    各行の色は固定小数点の差分で画素ごとに更新する(画素ごとに距離を計算しない)。
+//==============================================================*/
+#include "Color.hpp"
+#include "resolution.hpp"
+#include <stdint.h>
+
+class Gradient{
+
+    //================
+    // data
+    //================
+    public:
+    enum GRADIENT_TYPE{
+        LINEAR,
+        RADIAL
+    };
+    static const int n_ramp = 256;
+    static const int n_sqrt = 1024;
+
+    private:
+    GRADIENT_TYPE type;
+    ColorRGB ramp[ n_ramp ];
+    // LINEAR: t( x, y ) = dtdx * x + dtdy * y + t0 (16.16)
+    int32_t dtdx, dtdy, t0;
+    // RADIAL
+    float cx, cy, radius;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    Gradient();
+    // linear: t = 0 at (x0, y0) and t = 1 at (x1, y1), constant along the perpendicular lines / 線形
+    static Gradient linear( const float x0, const float y0, const float x1, const float y1, const ColorRGB &c0, const ColorRGB &c1 );
+    // radial: t = 0 at (cx, cy) and t = 1 on the circle of radius / 放射
+    static Gradient radial( const float cx, const float cy, const float radius, const ColorRGB &c0, const ColorRGB &c1 );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    void set_linear( const float x0, const float y0, const float x1, const float y1 );
+    void set_radial( const float cx, const float cy, const float radius );
+    void set_colors( const ColorRGB &c0, const ColorRGB &c1 );
+    // n color stops. positions must be increasing in [0, 1]. / 色の位置は[0, 1]で昇順
+    void set_colors( const ColorRGB *colors, const float *positions, const int n );
+    inline GRADIENT_TYPE get_type() const { return this->type; }
+
+    // Colors of the n pixels from (x, y) to (x + n - 1, y) / (x, y)から右にn画素の色
+    void shade_span( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const;
+
+    private:
+    void shade_linear( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const;
+    void shade_radial( const pixel_index_t x, const pixel_index_t y, const int n, ColorRGB *colors ) const;
+    static const uint8_t *sqrt_table();
+};
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef __HALF_SPACE_RASTERIZER_HPP__
+#define __HALF_SPACE_RASTERIZER_HPP__
+/*==============================================================//
+class HalfSpaceRasterizer
+    Block based rasterizer for convex Polygon2D. / 凸多角形用のブロック単位の処理
+    Each edge is an integer edge function E(x, y) = A x + B y + C,
+    positive inside the polygon. The fixed point unit is 1/sub_pixels
+    pixel, a multiple of 2 * n_rows of the Pattern (>= 16), so that the
+    sample positions of GridPattern and RooksPattern are exact.
+    The canvas is divided into BLOCK_SIZE x BLOCK_SIZE blocks and each
+    block is classified by the edge functions at its corners:
+      - OUTSIDE: no sample is inside. The block is skipped.
+      - INSIDE : all samples are inside. Filled without per pixel tests.
+      - PARTIAL: the coverage of each pixel is computed from the samples.
+    The coverage of a pixel is found per edge by a table of the samples
+    sorted by their offset of the edge function, so the cost is
+    O(edges x log(samples)) per partial pixel.
+    The vertices are rounded to the fixed point, so the coverage may differ
+    slightly from ActiveEdgeTable.
+
+    凸多角形の辺を整数の辺関数で表し、ブロックの角で判定して
+    完全に内側のブロックは画素ごとの判定をせずに塗りつぶす。
+//==============================================================*/
+#include "resolution.hpp"
+#include "Point2D.hpp"
+#include "Polygon2D.hpp"
+#include "SamplingPattern.hpp"
+#include "SmallVector.hpp"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+template <class Pattern = DefaultSamplingPattern, int BLOCK_SIZE = 8>
+class HalfSpaceRasterizer{
+    static_assert( Pattern::n_samples <= 32, "HalfSpaceRasterizer supports 32 samples at most." );
+
+    //================
+    // data
+    //================
+    public:
+    typedef typename Pattern::coverage_t coverage_t;
+    static const int block_size = BLOCK_SIZE;
+    enum BLOCK_STATE{
+        OUTSIDE,
+        INSIDE,
+        PARTIAL
+    };
+
+    private:
+    static const int32_t sub_pixels = 2 * Pattern::n_rows * ( ( 16 + 2 * Pattern::n_rows - 1 ) / ( 2 * Pattern::n_rows ) );
+    struct Edge{
+        int32_t a;    // dE/dx
+        int32_t b;    // dE/dy
+        int32_t c;
+        int32_t bias; // the sample is inside when E + offset >= bias (tie breaking)
+    };
+    // The buffers are in the object for the polygons up to n_inline_edges edges (the tables have n_samples entries
+    // for each edge, so fewer than Polygon2D::n_inline_vertices). / 小さいポリゴンはヒープを使わない
+    static const unsigned int n_inline_edges = 8;
+    SmallVector<Edge, n_inline_edges> edges;
+    // offsets of the samples for each edge, sorted in descending order / 辺ごとのサンプルのオフセット(降順)
+    SmallVector<int32_t, n_inline_edges * Pattern::n_samples> sorted_offsets;
+    // masks of the first k samples of sorted_offsets / 先頭k個のサンプルのマスク
+    SmallVector<uint32_t, n_inline_edges * ( Pattern::n_samples + 1 )> prefix_masks;
+    // sample positions from the pixel center / 画素中心からのサンプル位置
+    int32_t sample_x[Pattern::n_samples];
+    int32_t sample_y[Pattern::n_samples];
+    uint8_t n_samples;
+    // edges crossing the last classified PARTIAL block / 最後に判定した混合ブロックを横切る辺
+    SmallVector<uint16_t, n_inline_edges> block_edges;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    // The polygon must be convex. / 凸多角形であること
+    // The buffers beyond the inline size are taken from the arena if it is given / arenaがあれば領域をそこから確保
+    HalfSpaceRasterizer( const Polygon2D &convex_polygon, FrameArena *arena = NULL );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // Classify the block of the pixels [bx, bx+BLOCK_SIZE) x [by, by+BLOCK_SIZE)
+    BLOCK_STATE classify_block( const pixel_index_t bx, const pixel_index_t by );
+    // Coverage of the pixel (ix, iy) / 画素の被覆
+    coverage_t pixel_coverage( const pixel_index_t ix, const pixel_index_t iy ) const;
+    // Coverage of the pixels [x0, x1] in the row iy of the last classified PARTIAL block.
+    // 最後に判定した混合ブロック内の、行iyの画素の被覆
+    void compute_covered_areas( const pixel_index_t x0, const pixel_index_t x1, const pixel_index_t iy, coverage_t *areas ) const;
+    // Coverage of all samples
+    static coverage_t full_coverage();
+
+    private:
+    // value of the edge function n at the pixel center / 画素中心での辺関数の値
+    inline int32_t edge_value( const uint16_t n, const pixel_index_t ix, const pixel_index_t iy ) const{
+        const Edge &e = this->edges[n];
+        return e.a * ( ix * sub_pixels ) + e.b * ( iy * sub_pixels ) + e.c;
+    }
+    // mask of the samples inside the edge n for the edge value v at the pixel center.
+    // bit s is the s-th sample / 辺nの内側のサンプルのマスク
+    uint32_t edge_mask( const uint16_t n, const int32_t v ) const;
+    // coverage from the mask of the samples
+    static inline coverage_t to_coverage( const uint32_t mask ){
+        return Pattern::is_masked ? static_cast<coverage_t>( mask ) : static_cast<coverage_t>( __builtin_popcount( mask ) );
+    }
+    static inline uint32_t all_samples(){
+        return ( Pattern::n_samples == 32 ) ? 0xFFFFFFFFU : ( ( 1U << Pattern::n_samples ) - 1 );
+    }
+    static int32_t to_fixed( const coordinate_t v ){
+        return static_cast<int32_t>( floor( static_cast<float>( v ) / internal_scale * sub_pixels + 0.5f ) );
+    }
+};
+
+
+// サンプル位置を列挙し、辺関数と辺ごとのオフセット表を作る。
+// サンプルの番号は行jの順、行内ではiの順(GridPattern, RooksPatternのビットと同じ)
+template <class Pattern, int BLOCK_SIZE>
+HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::HalfSpaceRasterizer( const Polygon2D &convex_polygon, FrameArena *arena ){
+    this->edges.set_arena( arena );
+    this->sorted_offsets.set_arena( arena );
+    this->prefix_masks.set_arena( arena );
+    this->block_edges.set_arena( arena );
+    this->n_samples = 0;
+    for( uint8_t j = 0; j < Pattern::n_rows; j++ ){
+        for( uint8_t i = 0; i < Pattern::n_samples_in_row( j ); i++ ){
+            this->sample_x[this->n_samples] = to_fixed( Pattern::x_of_sample( 0, j, i ) );
+            this->sample_y[this->n_samples] = to_fixed( Pattern::y_of_row( 0, j ) );
+            this->n_samples++;
+        }
+    }
+
+    // 頂点を固定小数点(1/sub_pixels画素)に丸める
+    uint16_t np = convex_polygon.size();
+    SmallVector<int32_t, n_inline_edges> px, py;
+    px.set_arena( arena );
+    py.set_arena( arena );
+    px.resize( np );
+    py.resize( np );
+    this->edges.reserve( np );
+    this->sorted_offsets.reserve( np * this->n_samples );
+    this->prefix_masks.reserve( np * ( this->n_samples + 1 ) );
+    this->block_edges.reserve( np );
+    int64_t area2 = 0;
+    for( uint16_t n = 0; n < np; n++ ){
+        Point2D p = convex_polygon.get_Point2D( n );
+        px[n] = to_fixed( p.x );
+        py[n] = to_fixed( p.y );
+    }
+    for( uint16_t n = 0; n < np; n++ ){
+        uint16_t m = ( n + 1 ) % np;
+        area2 += static_cast<int64_t>( px[n] ) * py[m] - static_cast<int64_t>( px[m] ) * py[n];
+    }
+    // 面積0のポリゴンは何も描かない
+    if( area2 == 0 ){
+        return;
+    }
+    int32_t orientation = ( area2 > 0 ) ? 1 : -1;
+
+    for( uint16_t n = 0; n < np; n++ ){
+        uint16_t m = ( n + 1 ) % np;
+        if( px[n] == px[m] && py[n] == py[m] ){
+            continue;
+        }
+        // E(x, y) = ( x - x0 ) ( y1 - y0 ) - ( y - y0 ) ( x1 - x0 ), 内側が正になるように向きを揃える
+        Edge e;
+        e.a = -orientation * ( py[m] - py[n] );
+        e.b = orientation * ( px[m] - px[n] );
+        e.c = -( e.a * px[n] + e.b * py[n] );
+        // 辺上のサンプルは片側の辺にだけ含める
+        // (ActiveEdgeTableと同じく、右側と下側の辺上のサンプルを内側とする)
+        e.bias = ( e.a < 0 || ( e.a == 0 && e.b < 0 ) ) ? 0 : 1;
+        this->edges.push_back( e );
+
+        // サンプルをオフセットの降順に並べ、先頭k個のマスクを作る
+        uint8_t order[Pattern::n_samples];
+        int32_t offsets[Pattern::n_samples];
+        for( uint8_t s = 0; s < this->n_samples; s++ ){
+            order[s] = s;
+            offsets[s] = e.a * this->sample_x[s] + e.b * this->sample_y[s];
+        }
+        std::sort( order, order + this->n_samples, [&offsets]( const uint8_t l, const uint8_t r ){ return offsets[l] > offsets[r]; } );
+        uint32_t mask = 0;
+        this->prefix_masks.push_back( mask );
+        for( uint8_t s = 0; s < this->n_samples; s++ ){
+            this->sorted_offsets.push_back( offsets[order[s]] );
+            mask |= 1U << order[s];
+            this->prefix_masks.push_back( mask );
+        }
+    }
+}
+
+// ブロックの画素の範囲(サンプルを含む矩形)の角で、辺関数の最大と最小を調べる。
+template <class Pattern, int BLOCK_SIZE>
+typename HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::BLOCK_STATE HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::classify_block( const pixel_index_t bx, const pixel_index_t by ){
+    if( this->edges.empty() ){
+        return OUTSIDE;
+    }
+    int32_t x0 = bx * sub_pixels - sub_pixels / 2;
+    int32_t y0 = by * sub_pixels - sub_pixels / 2;
+    int32_t x1 = x0 + BLOCK_SIZE * sub_pixels;
+    int32_t y1 = y0 + BLOCK_SIZE * sub_pixels;
+    // ブロック全体が内側にある辺は、画素ごとに調べる必要がない
+    this->block_edges.clear();
+    for( uint16_t n = 0; n < this->edges.size(); n++ ){
+        const Edge &e = this->edges[n];
+        int32_t e_max = e.a * ( e.a > 0 ? x1 : x0 ) + e.b * ( e.b > 0 ? y1 : y0 ) + e.c;
+        if( e_max < e.bias ){
+            return OUTSIDE;
+        }
+        int32_t e_min = e.a * ( e.a > 0 ? x0 : x1 ) + e.b * ( e.b > 0 ? y0 : y1 ) + e.c;
+        if( e_min < e.bias ){
+            this->block_edges.push_back( n );
+        }
+    }
+    return this->block_edges.empty() ? INSIDE : PARTIAL;
+}
+
+// 内側になるサンプルの数kを二分探索で求め、先頭k個のマスクを返す。
+template <class Pattern, int BLOCK_SIZE>
+uint32_t HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::edge_mask( const uint16_t n, const int32_t v ) const{
+    // offset >= t のサンプルが内側
+    int32_t t = this->edges[n].bias - v;
+    const int32_t *offsets = &(this->sorted_offsets[ n * this->n_samples ]);
+    if( offsets[this->n_samples-1] >= t ){
+        return all_samples();
+    }
+    if( offsets[0] < t ){
+        return 0;
+    }
+    uint8_t lo = 1, hi = this->n_samples - 1;
+    while( lo < hi ){
+        uint8_t mid = ( lo + hi ) / 2;
+        if( offsets[mid] >= t ){
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return this->prefix_masks[ n * ( this->n_samples + 1 ) + lo ];
+}
+
+template <class Pattern, int BLOCK_SIZE>
+typename HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::coverage_t HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::pixel_coverage( const pixel_index_t ix, const pixel_index_t iy ) const{
+    if( this->edges.empty() ){
+        return 0;
+    }
+    uint32_t mask = all_samples();
+    for( uint16_t n = 0; n < this->edges.size() && mask != 0; n++ ){
+        mask &= edge_mask( n, edge_value( n, ix, iy ) );
+    }
+    return to_coverage( mask );
+}
+
+// ブロックを横切る辺だけについて、行内の画素を順に進め、辺関数を差分で更新する。
+template <class Pattern, int BLOCK_SIZE>
+void HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::compute_covered_areas( const pixel_index_t x0, const pixel_index_t x1, const pixel_index_t iy, coverage_t *areas ) const{
+    uint32_t masks[BLOCK_SIZE];
+    for( pixel_index_t ix = x0; ix <= x1; ix++ ){
+        masks[ix-x0] = all_samples();
+    }
+    for( uint16_t b = 0; b < this->block_edges.size(); b++ ){
+        uint16_t n = this->block_edges[b];
+        int32_t v = edge_value( n, x0, iy );
+        int32_t step = this->edges[n].a * sub_pixels;
+        for( pixel_index_t ix = x0; ix <= x1; ix++ ){
+            if( masks[ix-x0] != 0 ){
+                masks[ix-x0] &= edge_mask( n, v );
+            }
+            v += step;
+        }
+    }
+    for( pixel_index_t ix = x0; ix <= x1; ix++ ){
+        areas[ix-x0] = to_coverage( masks[ix-x0] );
+    }
+}
+
+template <class Pattern, int BLOCK_SIZE>
+typename HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::coverage_t HalfSpaceRasterizer<Pattern, BLOCK_SIZE>::full_coverage(){
+    return to_coverage( all_samples() );
+}
+
+#endif
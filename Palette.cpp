@@ -0,0 +1,65 @@
+#include "Palette.hpp"
+
+//================
+// constructor / コンストラクタ
+//================
+Palette::Palette( const ColorRGB *colors, const int n ){
+    set_colors( colors, n );
+}
+
+//================
+// Functions / 関数
+//================
+void Palette::set_colors( const ColorRGB *colors, const int n ){
+    const int n_colors = ( n < 0 ) ? 0 : ( ( n > 256 ) ? 256 : n );
+    this->colors.assign( colors, colors + n_colors );
+    if( n_colors > n_max_table_colors ){
+        // no table for a large palette, and release the table of the former palette / 大きいパレットは表を作らない
+        std::vector<uint8_t>().swap( this->table );
+        return;
+    }
+    this->table.resize( n_levels * n_colors * n_colors );
+    for( int l = 0; l < n_levels; l++ ){
+        for( int cur = 0; cur < n_colors; cur++ ){
+            uint8_t *row = &this->table[ ( l * n_colors + cur ) * n_colors ];
+            for( int org = 0; org < n_colors; org++ ){
+                row[ org ] = blend_colors( org, cur, l );
+            }
+        }
+    }
+}
+
+uint8_t Palette::blend_colors( const uint8_t org, const uint8_t cur, const int level ) const{
+    const int alpha = ( level == n_levels - 1 ) ? 128 : level * 8;
+    // the ends are exact, even if the palette has the same color twice / 両端は計算しない
+    if( alpha == 0 ){
+        return cur;
+    }
+    if( alpha == 128 ){
+        return org;
+    }
+    // the same as PixelSpans::alpha_blend / PixelSpans::alpha_blendと同じ計算
+    uint8_t c[3];
+    for( int k = 0; k < 3; k++ ){
+        int o = this->colors[ org ].color[k];
+        int s = this->colors[ cur ].color[k];
+        c[k] = ( ( alpha * ( o - s ) ) >> 7 ) + s;
+    }
+    return nearest( c[0], c[1], c[2] );
+}
+
+uint8_t Palette::nearest( const uint8_t r8, const uint8_t g8, const uint8_t b8 ) const{
+    uint8_t best = 0;
+    int32_t best_d = 0x7FFFFFFF;
+    for( int i = 0; i < (int)this->colors.size(); i++ ){
+        int32_t dr = r8 - this->colors[i].color[0];
+        int32_t dg = g8 - this->colors[i].color[1];
+        int32_t db = b8 - this->colors[i].color[2];
+        int32_t d = dr * dr + dg * dg + db * db;
+        if( d < best_d ){
+            best_d = d;
+            best = i;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,81 @@
+#ifndef __PALETTE_HPP__
+#define __PALETTE_HPP__
+/*==============================================================//
+class Palette
+    Up to 256 colors (8-bit RGB) of the indexed pixel formats, and the
+    blend table of the palette.
+    インデックスカラーのパレット(最大256色)と合成表。
+
+    A blend of two palette colors is looked up in a table instead of
+    blending the RGB channels and searching the nearest color:
+        table[ level ][ cur ][ org ] = nearest( alpha_blend( org, cur, alpha ) )
+    The alpha of Canvas (0: opaque, 128: transparent) is quantized to
+    n_levels = 17 levels (alpha = 0, 8, ..., 128).
+    The table has 17 * n * n bytes for n colors (4.3 KB for 16 colors),
+    and is built by set_colors() for up to n_max_table_colors = 32 colors
+    (17 KB). A larger palette (e.g. 256 colors for 8 bits per pixel, which
+    would need 1.1 MB) has no table: each blend is computed in RGB and
+    searched by nearest(), which is slower but gives the same result.
+    2色の合成はRGBで計算せず表を引く。表は17 * n * nバイト(16色で4.3KB)。
+    表は32色(17KB)まで。それより多い色は表を作らず、合成ごとに最も近い色を探す(遅い)。
+//==============================================================*/
+#include "Color.hpp"
+#include <stdint.h>
+#include <vector>
+
+class Palette{
+
+    //================
+    // variables
+    //================
+    public:
+    static const int n_levels = 17;
+    // the blend table is built for palettes up to this number of colors / 合成表を作る最大の色数
+    static const int n_max_table_colors = 32;
+    private:
+    std::vector<ColorRGB> colors;
+    std::vector<uint8_t> table;
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    Palette(){}
+    Palette( const ColorRGB *colors, const int n );
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    // Set the colors (8 bits per channel, n <= 256) and build the blend table / 色を設定して合成表を作る
+    void set_colors( const ColorRGB *colors, const int n );
+    inline int size() const { return this->colors.size(); }
+    inline const ColorRGB &get_color( const uint8_t index ) const { return this->colors[ index ]; }
+    // The index of the nearest color / 最も近い色の番号
+    uint8_t nearest( const uint8_t r8, const uint8_t g8, const uint8_t b8 ) const;
+
+    // the level of the table for the alpha, alpha > 128 is the same as 128 / alphaに対応する表の段
+    static inline int level( const uint8_t alpha ){
+        return ( alpha >= 128 ) ? n_levels - 1 : ( alpha + 4 ) >> 3;
+    }
+    inline bool has_table() const { return !this->table.empty(); }
+    // The blended index for each index of the pixel (org), or NULL if the palette has no table
+    // 画素の色番号(org)ごとの合成結果。表がなければNULL
+    inline const uint8_t *blend_row( const uint8_t cur, const uint8_t alpha ) const{
+        if( !has_table() ){
+            return NULL;
+        }
+        const int n = this->colors.size();
+        return &this->table[ ( level( alpha ) * n + cur ) * n ];
+    }
+    // org blended with cur by alpha / orgにcurをalphaで合成した色番号
+    inline uint8_t blend( const uint8_t org, const uint8_t cur, const uint8_t alpha ) const{
+        return has_table() ? blend_row( cur, alpha )[ org ] : blend_colors( org, cur, level( alpha ) );
+    }
+
+    private:
+    // the nearest color of org blended with cur by the alpha of the level / 段のalphaで合成した色に最も近い色
+    uint8_t blend_colors( const uint8_t org, const uint8_t cur, const int level ) const;
+};
+
+#endif
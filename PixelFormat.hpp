@@ -0,0 +1,843 @@
+#ifndef __PIXEL_FORMAT_HPP__
+#define __PIXEL_FORMAT_HPP__
+/*==============================================================//
+class PixelFormat16, PixelFormat8, PixelFormat888, PixelFormat1, PixelFormatIndexed
+    Compile-time descriptors of 16-bit and 8-bit packed RGB, 8-bit per
+    channel (24 or 32 bits per pixel), 1-bit monochrome and indexed
+    (palette) pixel formats.
+    Canvas takes the format as a template parameter, so the pack and
+    unpack of a pixel are inlined into the drawing loops (no virtual call).
+    画素フォーマットの記述子(16bit RGB)。Canvasのテンプレート引数に渡すので、
+    画素の読み書きは描画ループ内に展開される。
+
+    Each channel is stored in the Color with its own bit width
+    (e.g. 5, 6, 5 bits for RGB565), and placed at *_SHIFT in the 16-bit word.
+    ORDER gives the order of the two bytes in the memory.
+    各チャンネルはビット幅のままColorに入れる。
+
+    A format class must define
+        typedef ... Color;
+        static const unsigned int bytes_per_pixel;
+        static void get_Color( const uint8_t *p_data, Color &color );
+        static void set_Color( uint8_t *p_data, const Color &color );
+        static void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 );
+        static void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color );
+    and the span functions of PixelSpans. PixelSpans also defines
+        static void ColorRGB_to_Color( const ColorRGB &rgb, Color &color );
+    for the ColorRGB of a picture or a gradient, which is copied as it is
+    (the channels are already in the bit widths of the format). A format
+    whose Color is not ColorRGB hides it. Derive from PixelSpans<Format>
+    to get the generic ones, and hide them with faster versions if any.
+    A pixel is addressed by Format::Pointer. PixelSpans defines it as
+    uint8_t * with bytes_per_pixel bytes per pixel, together with
+        static Pointer pixel_pointer( uint8_t *row, const int x, const int y );
+        static Pointer advance( const Pointer p, const int n );
+        static constexpr unsigned int row_bytes( const unsigned int width );
+    A format of less than a byte per pixel (PixelFormat1) hides all of them.
+    画素はFormat::Pointerで指す。1バイト未満の形式はこれらを定義し直す。
+    bmp_bit_count is 24 or 32 if the bytes of a pixel are in the order of
+    a BMP file (B, G, R [, X]), so a row is written without conversion,
+    and 0 otherwise (PixelSpans defines 0).
+//==============================================================*/
+#include "Color.hpp"
+#include "BlendKernels.hpp"
+#include "Palette.hpp"
+#include <stdint.h>
+#include <string.h>
+
+/*==============================================================//
+class PixelSpans
+    Generic span functions of a pixel format, by get_Color, set_Color and
+    alpha_blend of each pixel. / 画素単位の汎用のスパン関数
+    alpha = 0 is opaque and alpha = 128 is transparent (same as Canvas).
+//==============================================================*/
+template <class Format>
+class PixelSpans{
+    public:
+    static const unsigned int bmp_bit_count = 0;
+    typedef uint8_t *Pointer;
+    // the pixel x of the row y / 行yの画素x
+    static inline Pointer pixel_pointer( uint8_t *row, const int x, const int ){
+        return row + x * Format::bytes_per_pixel;
+    }
+    // n pixels to the right / n画素右
+    static inline Pointer advance( const Pointer p, const int n ){
+        return p + n * Format::bytes_per_pixel;
+    }
+    static constexpr unsigned int row_bytes( const unsigned int width ){
+        return width * Format::bytes_per_pixel;
+    }
+    // The face color of a picture or a color of a gradient to the Color / ColoredPolygon2D, Gradientの色をColorに
+    static inline void ColorRGB_to_Color( const ColorRGB &rgb, ColorRGB &color ){
+        color = rgb;
+    }
+    // new = ( alpha * ( org - cur ) >> 7 ) + cur for each channel / 各チャンネルの合成
+    template <class ColorT>
+    static inline void alpha_blend( const ColorT &color_org, const ColorT &color_cur, const uint8_t alpha, ColorT &new_color ){
+        for( int c = 0; c < ColorT::n_color; c++ ){
+            new_color.color[c] = ( ( alpha * ( static_cast<color_alpha_blend_t>(color_org.color[c]) - static_cast<color_alpha_blend_t>(color_cur.color[c]) )) >> 7 ) + color_cur.color[c];
+        }
+    }
+    // Write the color to n pixels from p_data / n画素を塗りつぶす
+    template <class PointerT, class ColorT>
+    static inline void fill_span( PointerT p_data, const int n, const ColorT &color ){
+        for( int i = 0; i < n; i++ ){
+            Format::set_Color( p_data, color );
+            p_data = Format::advance( p_data, 1 );
+        }
+    }
+    // Blend the color to n pixels with the same alpha / 同じalphaでn画素に合成
+    template <class PointerT, class ColorT>
+    static inline void blend_span( PointerT p_data, const int n, const ColorT &color, const uint8_t alpha ){
+        ColorT org_color;
+        for( int i = 0; i < n; i++ ){
+            Format::get_Color( p_data, org_color );
+            Format::alpha_blend( org_color, color, alpha, org_color );
+            Format::set_Color( p_data, org_color );
+            p_data = Format::advance( p_data, 1 );
+        }
+    }
+    // Blend the color to n pixels with the alpha of each pixel / 画素ごとのalphaでn画素に合成
+    template <class PointerT, class ColorT>
+    static inline void blend_span( PointerT p_data, const uint8_t *alphas, const int n, const ColorT &color ){
+        ColorT org_color;
+        for( int i = 0; i < n; i++ ){
+            Format::get_Color( p_data, org_color );
+            Format::alpha_blend( org_color, color, alphas[i], org_color );
+            Format::set_Color( p_data, org_color );
+            p_data = Format::advance( p_data, 1 );
+        }
+    }
+};
+
+/*==============================================================//
+class OrderedDither
+    4x4 ordered dither (Bayer matrix). threshold() is in [8, 248], so
+    0 is always below it and 255 is always above it.
+    Quantize v in [0, 255] to n bits by ( v * ( 2^n - 1 ) + threshold ) >> 8.
+    4x4の組織的ディザの閾値
+//==============================================================*/
+class OrderedDither{
+    public:
+    // 16 * bayer + 8 for the pixel (x, y) / 画素(x, y)の閾値
+    static inline uint8_t threshold( const int x, const int y ){
+        static const uint8_t bayer[4][4] = {
+            {   8, 136,  40, 168 },
+            { 200,  72, 232, 104 },
+            {  56, 184,  24, 152 },
+            { 248, 120, 216,  88 }
+        };
+        return bayer[ y & 3 ][ x & 3 ];
+    }
+    // v in [0, 255] to [0, 2^BITS - 1] / BITSビットに量子化
+    template <uint8_t BITS>
+    static inline uint8_t quantize( const uint8_t v, const int x, const int y ){
+        return ( v * ( ( 1U << BITS ) - 1 ) + threshold( x, y ) ) >> 8;
+    }
+};
+
+enum PIXEL_BYTE_ORDER{
+    MSB_FIRST, // the upper byte first (SSD1331 and most SPI displays) / 上位バイトが先
+    LSB_FIRST  // the lower byte first (little endian CPUs) / 下位バイトが先
+};
+
+template <
+    uint8_t R_BITS, uint8_t R_SHIFT,
+    uint8_t G_BITS, uint8_t G_SHIFT,
+    uint8_t B_BITS, uint8_t B_SHIFT,
+    PIXEL_BYTE_ORDER ORDER
+>
+class PixelFormat16 : public PixelSpans< PixelFormat16<R_BITS, R_SHIFT, G_BITS, G_SHIFT, B_BITS, B_SHIFT, ORDER> >{
+    typedef PixelSpans< PixelFormat16<R_BITS, R_SHIFT, G_BITS, G_SHIFT, B_BITS, B_SHIFT, ORDER> > Generic;
+    public:
+    typedef ColorRGB Color;
+    static const unsigned int bytes_per_pixel = 2;
+    static const uint8_t r_bits = R_BITS;
+    static const uint8_t g_bits = G_BITS;
+    static const uint8_t b_bits = B_BITS;
+    static const uint8_t r_shift = R_SHIFT;
+    static const uint8_t g_shift = G_SHIFT;
+    static const uint8_t b_shift = B_SHIFT;
+    static const PIXEL_BYTE_ORDER byte_order = ORDER;
+    // 5 bits at 0, 6 bits at 5 and 5 bits at 11 (RGB565 and BGR565). The span functions use BlendKernels for this layout.
+    static const bool is_565 = G_BITS == 6 && G_SHIFT == 5 && R_BITS == 5 && B_BITS == 5 && R_SHIFT + B_SHIFT == 11 && ( R_SHIFT == 0 || B_SHIFT == 0 );
+
+    //================
+    // Functions / 関数
+    //================
+    static inline uint16_t load( const uint8_t *p_data ){
+        if( ORDER == MSB_FIRST ){
+            return ( static_cast<uint16_t>( p_data[0] ) << 8 ) | p_data[1];
+        }else{
+            return ( static_cast<uint16_t>( p_data[1] ) << 8 ) | p_data[0];
+        }
+    }
+    static inline void store( uint8_t *p_data, const uint16_t v ){
+        if( ORDER == MSB_FIRST ){
+            p_data[0] = v >> 8;
+            p_data[1] = v & 0xFF;
+        }else{
+            p_data[0] = v & 0xFF;
+            p_data[1] = v >> 8;
+        }
+    }
+    // pack / unpack the channels of the Color (each channel is in [0, 2^bits-1])
+    static inline uint16_t pack( const Color &color ){
+        return ( color.color[0] << R_SHIFT ) | ( color.color[1] << G_SHIFT ) | ( color.color[2] << B_SHIFT );
+    }
+    static inline void unpack( const uint16_t v, Color &color ){
+        color.color[0] = ( v >> R_SHIFT ) & ( ( 1U << R_BITS ) - 1 );
+        color.color[1] = ( v >> G_SHIFT ) & ( ( 1U << G_BITS ) - 1 );
+        color.color[2] = ( v >> B_SHIFT ) & ( ( 1U << B_BITS ) - 1 );
+    }
+
+    static inline void get_Color( const uint8_t *p_data, Color &color ){
+        unpack( load( p_data ), color );
+    }
+    static inline void set_Color( uint8_t *p_data, const Color &color ){
+        store( p_data, pack( color ) );
+    }
+    // Expand each channel to 8 bits by repeating the upper bits. / 上位ビットを繰り返して8bitに拡張
+    static inline void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 ){
+        r8 = expand<R_BITS>( color.color[0] );
+        g8 = expand<G_BITS>( color.color[1] );
+        b8 = expand<B_BITS>( color.color[2] );
+    }
+    // Truncate 8-bit channels to the bit widths of the format. / 8bitからフォーマットのビット幅に切り捨て
+    static inline void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color ){
+        color.color[0] = r8 >> ( 8 - R_BITS );
+        color.color[1] = g8 >> ( 8 - G_BITS );
+        color.color[2] = b8 >> ( 8 - B_BITS );
+    }
+    template <uint8_t BITS>
+    static inline uint8_t expand( const uint8_t v ){
+        static_assert( 4 <= BITS && BITS <= 8, "4 to 8 bits per channel" );
+        return ( v << ( 8 - BITS ) ) | ( v >> ( 2 * BITS - 8 ) );
+    }
+
+    //================
+    // Span functions / スパン関数
+    //================
+    // Write the color to n pixels. Two pixels are written by one 32-bit store. / 32bit単位で2画素ずつ書く
+    // p_data must be 2-byte aligned, as the pixels of a canvas are. / p_dataは2バイト境界
+    static inline void fill_span( uint8_t *p_data, int n, const Color &color ){
+        uint8_t pixel[2];
+        set_Color( pixel, color );
+        // the first pixel to align the pointer to 4 bytes / 4バイト境界に揃える
+        if( n > 0 && ( reinterpret_cast<uintptr_t>( p_data ) & 0x3 ) ){
+            p_data[0] = pixel[0];
+            p_data[1] = pixel[1];
+            p_data += 2;
+            n--;
+        }
+        const uint8_t pattern_bytes[4] = { pixel[0], pixel[1], pixel[0], pixel[1] };
+        uint32_t pattern;
+        memcpy( &pattern, pattern_bytes, 4 );
+        // memcpy, not a uint32_t pointer (the data are uint8_t). An aligned 4-byte memcpy is one 32-bit store.
+        // uint32_t*で書かずmemcpyで書く(同じストア命令になる)
+        uint8_t *p_aligned = static_cast<uint8_t*>( __builtin_assume_aligned( p_data, 4 ) );
+        for( int i = 0; i < n / 2; i++ ){
+            memcpy( p_aligned + i * 4, &pattern, 4 );
+        }
+        if( n & 1 ){
+            p_data += ( n - 1 ) * 2;
+            p_data[0] = pixel[0];
+            p_data[1] = pixel[1];
+        }
+    }
+    static inline void blend_span( uint8_t *p_data, const int n, const Color &color, const uint8_t alpha ){
+        if( alpha == 0 ){
+            fill_span( p_data, n, color );
+            return;
+        }
+        if( alpha == 128 ){
+            return;
+        }
+        if( !is_565 || alpha > 128 ){
+            Generic::blend_span( p_data, n, color, alpha );
+            return;
+        }
+        const uint16_t cur = pack( color );
+        if( n >= BlendKernels::min_span ){
+            BlendKernels::blend_span( p_data, n, cur, alpha, ORDER == MSB_FIRST );
+            return;
+        }
+        // ( 128 - alpha ) * cur is the same for all pixels / 全画素で共通
+        const uint32_t weighted_cur_5_5 = ( 128 - alpha ) * BlendKernels::spread_5_5( cur );
+        const uint32_t weighted_cur_6 = ( 128 - alpha ) * static_cast<uint32_t>( cur & 0x07E0 );
+        for( int i = 0; i < n; i++ ){
+            store( p_data, BlendKernels::blend_565( load( p_data ), alpha, weighted_cur_5_5, weighted_cur_6 ) );
+            p_data += 2;
+        }
+    }
+    // alphas must be in [0, 128] / alphasは[0, 128]
+    static inline void blend_span( uint8_t *p_data, const uint8_t *alphas, const int n, const Color &color ){
+        if( !is_565 ){
+            Generic::blend_span( p_data, alphas, n, color );
+            return;
+        }
+        const uint16_t cur = pack( color );
+        if( n >= BlendKernels::min_span ){
+            BlendKernels::blend_span( p_data, alphas, n, cur, ORDER == MSB_FIRST );
+            return;
+        }
+        const uint32_t cur_5_5 = BlendKernels::spread_5_5( cur );
+        const uint32_t cur_6 = cur & 0x07E0;
+        for( int i = 0; i < n; i++ ){
+            uint8_t alpha = alphas[i];
+            if( alpha == 0 ){
+                store( p_data, cur );
+            }else if( alpha < 128 ){
+                store( p_data, BlendKernels::blend_565( load( p_data ), alpha, ( 128 - alpha ) * cur_5_5, ( 128 - alpha ) * cur_6 ) );
+            }
+            p_data += 2;
+        }
+    }
+};
+
+// RRRRRGGG GGGBBBBB (the byte order of SSD1331)
+typedef PixelFormat16<5, 11, 6, 5, 5, 0, MSB_FIRST> PixelFormat_RGB565;
+// GGGBBBBB RRRRRGGG (RGB565 in a uint16_t of a little endian CPU)
+typedef PixelFormat16<5, 11, 6, 5, 5, 0, LSB_FIRST> PixelFormat_RGB565_LE;
+// BBBBBGGG GGGRRRRR
+typedef PixelFormat16<5, 0, 6, 5, 5, 11, MSB_FIRST> PixelFormat_BGR565;
+// GGGRRRRR BBBBBGGG
+typedef PixelFormat16<5, 0, 6, 5, 5, 11, LSB_FIRST> PixelFormat_BGR565_LE;
+
+/*==============================================================//
+class PixelFormat8
+    8-bit packed RGB (e.g. RGB332, the 256-color mode of SSD1331).
+    Each channel is stored in the Color with its own bit width, the same
+    as PixelFormat16. Convert an image of more colors with an ordered
+    dither (Canvas_RGB332::dither_from), not by RGB888_to_Color.
+    8bitのRGB。チャンネルはビット幅のままColorに入れる。
+//==============================================================*/
+template <
+    uint8_t R_BITS, uint8_t R_SHIFT,
+    uint8_t G_BITS, uint8_t G_SHIFT,
+    uint8_t B_BITS, uint8_t B_SHIFT
+>
+class PixelFormat8 : public PixelSpans< PixelFormat8<R_BITS, R_SHIFT, G_BITS, G_SHIFT, B_BITS, B_SHIFT> >{
+    public:
+    typedef ColorRGB Color;
+    static const unsigned int bytes_per_pixel = 1;
+    static const uint8_t r_bits = R_BITS;
+    static const uint8_t g_bits = G_BITS;
+    static const uint8_t b_bits = B_BITS;
+
+    //================
+    // Functions / 関数
+    //================
+    static inline uint8_t pack( const Color &color ){
+        return ( color.color[0] << R_SHIFT ) | ( color.color[1] << G_SHIFT ) | ( color.color[2] << B_SHIFT );
+    }
+    static inline void get_Color( const uint8_t *p_data, Color &color ){
+        color.color[0] = ( *p_data >> R_SHIFT ) & ( ( 1U << R_BITS ) - 1 );
+        color.color[1] = ( *p_data >> G_SHIFT ) & ( ( 1U << G_BITS ) - 1 );
+        color.color[2] = ( *p_data >> B_SHIFT ) & ( ( 1U << B_BITS ) - 1 );
+    }
+    static inline void set_Color( uint8_t *p_data, const Color &color ){
+        *p_data = pack( color );
+    }
+    static inline void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 ){
+        r8 = expand<R_BITS>( color.color[0] );
+        g8 = expand<G_BITS>( color.color[1] );
+        b8 = expand<B_BITS>( color.color[2] );
+    }
+    static inline void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color ){
+        color.color[0] = r8 >> ( 8 - R_BITS );
+        color.color[1] = g8 >> ( 8 - G_BITS );
+        color.color[2] = b8 >> ( 8 - B_BITS );
+    }
+    // Expand to 8 bits by repeating the bits (2 and 3 bits are repeated more than once) / ビットを繰り返して8bitに拡張
+    template <uint8_t BITS>
+    static inline uint8_t expand( const uint8_t v ){
+        static_assert( 1 <= BITS && BITS <= 8, "1 to 8 bits per channel" );
+        uint8_t v8 = 0;
+        for( int s = 8 - BITS; s > -BITS; s -= BITS ){
+            v8 |= ( s >= 0 ) ? ( v << s ) : ( v >> -s );
+        }
+        return v8;
+    }
+
+    //================
+    // Span functions / スパン関数
+    //================
+    static inline void fill_span( uint8_t *p_data, const int n, const Color &color ){
+        memset( p_data, pack( color ), n );
+    }
+};
+
+// RRRGGGBB (the 256-color mode of SSD1331)
+typedef PixelFormat8<3, 5, 3, 2, 2, 0> PixelFormat_RGB332;
+
+/*==============================================================//
+class PixelFormat888
+    8 bits per channel, BYTES (3 or 4) bytes per pixel. R_INDEX, G_INDEX
+    and B_INDEX are the positions of the channels in the bytes of a pixel.
+    The other byte of a 4-byte pixel (X) is written as 0xFF.
+    The 4-byte formats keep each pixel on a 4-byte boundary, and are
+    blended by SWAR: two channels in a 32-bit word by one multiply-add.
+    1チャンネル8bit。4バイトの形式は画素が4バイト境界に揃い、32bit単位で2チャンネルずつ合成する。
+//==============================================================*/
+template <
+    uint8_t BYTES,
+    uint8_t R_INDEX, uint8_t G_INDEX, uint8_t B_INDEX
+>
+class PixelFormat888 : public PixelSpans< PixelFormat888<BYTES, R_INDEX, G_INDEX, B_INDEX> >{
+    typedef PixelSpans< PixelFormat888<BYTES, R_INDEX, G_INDEX, B_INDEX> > Generic;
+    static_assert( BYTES == 3 || BYTES == 4, "3 or 4 bytes per pixel" );
+    public:
+    typedef ColorRGB Color;
+    static const unsigned int bytes_per_pixel = BYTES;
+    static const unsigned int bmp_bit_count = ( B_INDEX == 0 && G_INDEX == 1 && R_INDEX == 2 ) ? BYTES * 8 : 0;
+
+    //================
+    // Functions / 関数
+    //================
+    static inline void get_Color( const uint8_t *p_data, Color &color ){
+        color.color[0] = p_data[ R_INDEX ];
+        color.color[1] = p_data[ G_INDEX ];
+        color.color[2] = p_data[ B_INDEX ];
+    }
+    static inline void set_Color( uint8_t *p_data, const Color &color ){
+        p_data[ R_INDEX ] = color.color[0];
+        p_data[ G_INDEX ] = color.color[1];
+        p_data[ B_INDEX ] = color.color[2];
+        if( BYTES == 4 ){
+            p_data[ 6 - R_INDEX - G_INDEX - B_INDEX ] = 0xFF;
+        }
+    }
+    static inline void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 ){
+        r8 = color.color[0];
+        g8 = color.color[1];
+        b8 = color.color[2];
+    }
+    static inline void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color ){
+        color.color[0] = r8;
+        color.color[1] = g8;
+        color.color[2] = b8;
+    }
+
+    //================
+    // Span functions / スパン関数
+    //================
+    static inline void fill_span( uint8_t *p_data, const int n, const Color &color ){
+        if( BYTES != 4 ){
+            Generic::fill_span( p_data, n, color );
+            return;
+        }
+        const uint32_t pattern = word( color );
+        for( int i = 0; i < n; i++ ){
+            memcpy( p_data, &pattern, 4 );
+            p_data += 4;
+        }
+    }
+    static inline void blend_span( uint8_t *p_data, const int n, const Color &color, const uint8_t alpha ){
+        if( alpha == 0 ){
+            fill_span( p_data, n, color );
+            return;
+        }
+        if( alpha == 128 ){
+            return;
+        }
+        if( BYTES != 4 || alpha > 128 ){
+            Generic::blend_span( p_data, n, color, alpha );
+            return;
+        }
+        const uint32_t cur = word( color );
+        // ( 128 - alpha ) * cur is the same for all pixels / 全画素で共通
+        const uint32_t weighted_cur_even = ( 128 - alpha ) * ( cur & 0x00FF00FF );
+        const uint32_t weighted_cur_odd = ( 128 - alpha ) * ( ( cur >> 8 ) & 0x00FF00FF );
+        for( int i = 0; i < n; i++ ){
+            blend_word( p_data, alpha, weighted_cur_even, weighted_cur_odd );
+            p_data += 4;
+        }
+    }
+    // alphas must be in [0, 128] / alphasは[0, 128]
+    static inline void blend_span( uint8_t *p_data, const uint8_t *alphas, const int n, const Color &color ){
+        if( BYTES != 4 ){
+            Generic::blend_span( p_data, alphas, n, color );
+            return;
+        }
+        const uint32_t cur = word( color );
+        const uint32_t cur_even = cur & 0x00FF00FF;
+        const uint32_t cur_odd = ( cur >> 8 ) & 0x00FF00FF;
+        for( int i = 0; i < n; i++ ){
+            uint8_t alpha = alphas[i];
+            if( alpha == 0 ){
+                memcpy( p_data, &cur, 4 );
+            }else if( alpha < 128 ){
+                blend_word( p_data, alpha, ( 128 - alpha ) * cur_even, ( 128 - alpha ) * cur_odd );
+            }
+            p_data += 4;
+        }
+    }
+
+    private:
+    // the 4 bytes of the pixel as a word in the memory order / 画素の4バイト(メモリの順)
+    static inline uint32_t word( const Color &color ){
+        uint8_t pixel[4];
+        set_Color( pixel, color );
+        uint32_t v;
+        memcpy( &v, pixel, 4 );
+        return v;
+    }
+    // ( alpha * org + ( 128 - alpha ) * cur ) >> 7 for the bytes 0, 2 and 1, 3 of the word, the same as alpha_blend.
+    // Each product is less than 2^15, so the two bytes in a 32-bit word do not overlap.
+    // 積は2^15未満なので、32bitに2バイトずつ入れて合成できる
+    static inline void blend_word( uint8_t *p_data, const uint8_t alpha, const uint32_t weighted_cur_even, const uint32_t weighted_cur_odd ){
+        uint32_t v;
+        memcpy( &v, p_data, 4 );
+        uint32_t even = ( ( alpha * ( v & 0x00FF00FF ) + weighted_cur_even ) >> 7 ) & 0x00FF00FF;
+        uint32_t odd = ( ( alpha * ( ( v >> 8 ) & 0x00FF00FF ) + weighted_cur_odd ) >> 7 ) & 0x00FF00FF;
+        v = even | ( odd << 8 ) | x_mask();
+        memcpy( p_data, &v, 4 );
+    }
+    // the X byte in the word, written as 0xFF like set_Color / Xのバイトはset_Colorと同じく0xFF
+    static inline uint32_t x_mask(){
+        uint8_t bytes[4] = { 0, 0, 0, 0 };
+        bytes[ 6 - R_INDEX - G_INDEX - B_INDEX ] = 0xFF;
+        uint32_t v;
+        memcpy( &v, bytes, 4 );
+        return v;
+    }
+};
+
+// BB GG RR (0xRRGGBB in a little endian CPU, the order of BMP files)
+typedef PixelFormat888<3, 2, 1, 0> PixelFormat_RGB888;
+// RR GG BB
+typedef PixelFormat888<3, 0, 1, 2> PixelFormat_BGR888;
+// BB GG RR XX (0xXXRRGGBB in a little endian CPU, the order of 32-bit BMP files)
+typedef PixelFormat888<4, 2, 1, 0> PixelFormat_XRGB8888;
+// RR GG BB XX
+typedef PixelFormat888<4, 0, 1, 2> PixelFormat_XBGR8888;
+
+/*==============================================================//
+class PixelFormat1
+    1 bit per pixel monochrome (1: white, 0: black), 8 pixels in a byte.
+    The rows are horizontal, (width + 7) / 8 bytes each. ORDER gives the
+    pixel in the MSB of a byte: MSB_FIRST is the left most pixel (e-paper
+    controllers, PBM), LSB_FIRST is the right most one.
+    The vertical page layout of SSD1306 is not supported.
+    1画素1bitの白黒。1バイトに8画素、行は横方向。
+
+    The Color is 8-bit RGB. set_Color thresholds the luminance by a 4x4
+    ordered dither (OrderedDither), so the anti-aliased edges, alpha and
+    gradients are drawn as dither patterns.
+    A pixel is addressed by Pointer (the byte, the bit and the row of the
+    dither matrix). fill_span and blend_span with a constant alpha write
+    whole bytes: the dither pattern of a row repeats every 4 pixels, so
+    a byte of 8 pixels is the same along the row.
+    輝度を4x4の組織的ディザで2値化する。塗りつぶしは1バイト(8画素)単位で書く。
+//==============================================================*/
+template <PIXEL_BYTE_ORDER ORDER>
+class PixelFormat1 : public PixelSpans< PixelFormat1<ORDER> >{
+    typedef PixelSpans< PixelFormat1<ORDER> > Generic;
+    public:
+    typedef ColorRGB Color;
+    // less than a byte, see Pointer / 1バイト未満
+    static const unsigned int bytes_per_pixel = 0;
+    static const unsigned int bits_per_pixel = 1;
+    struct Pointer{
+        uint8_t *byte;
+        uint8_t bit;        // the position in the byte, 0: the left most pixel / バイト内の位置(0が左端)
+        uint8_t dither_row; // y & 3
+    };
+
+    //================
+    // Functions / 関数
+    //================
+    static inline Pointer pixel_pointer( uint8_t *row, const int x, const int y ){
+        Pointer p;
+        p.byte = row + ( x >> 3 );
+        p.bit = x & 7;
+        p.dither_row = y & 3;
+        return p;
+    }
+    static inline Pointer advance( Pointer p, const int n ){
+        int bit = p.bit + n;
+        p.byte += bit >> 3;
+        p.bit = bit & 7;
+        return p;
+    }
+    static constexpr unsigned int row_bytes( const unsigned int width ){
+        return ( width + 7 ) / 8;
+    }
+
+    static inline void get_Color( const Pointer &p, Color &color ){
+        uint8_t v = ( *p.byte & bit_mask( p.bit ) ) ? 255 : 0;
+        color.color[0] = v;
+        color.color[1] = v;
+        color.color[2] = v;
+    }
+    static inline void set_Color( const Pointer &p, const Color &color ){
+        if( luminance( color ) >= OrderedDither::threshold( p.bit, p.dither_row ) ){
+            *p.byte |= bit_mask( p.bit );
+        }else{
+            *p.byte &= ~bit_mask( p.bit );
+        }
+    }
+    static inline void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 ){
+        r8 = color.color[0];
+        g8 = color.color[1];
+        b8 = color.color[2];
+    }
+    static inline void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color ){
+        color.color[0] = r8;
+        color.color[1] = g8;
+        color.color[2] = b8;
+    }
+
+    //================
+    // Span functions / スパン関数
+    //================
+    static inline void fill_span( const Pointer &p, int n, const Color &color ){
+        const uint8_t pattern = row_pattern( luminance( color ), p.dither_row );
+        uint8_t *b = p.byte;
+        if( p.bit != 0 && n > 0 ){
+            int m = ( n < 8 - p.bit ) ? n : 8 - p.bit;
+            uint8_t mask = span_mask( p.bit, m );
+            *b = ( *b & ~mask ) | ( pattern & mask );
+            b++;
+            n -= m;
+        }
+        memset( b, pattern, n >> 3 );
+        b += n >> 3;
+        if( n & 7 ){
+            uint8_t mask = span_mask( 0, n & 7 );
+            *b = ( *b & ~mask ) | ( pattern & mask );
+        }
+    }
+    // A pixel is black or white before the blend, so there are only two blended colors.
+    // The new byte is the pattern of the blended white for the white pixels and
+    // the pattern of the blended black for the black pixels. Same as the generic one.
+    // 合成前の画素は白か黒なので、合成後の色も2通り。白の画素と黒の画素にそれぞれのパターンを書く。
+    static inline void blend_span( const Pointer &p, int n, const Color &color, const uint8_t alpha ){
+        if( alpha == 0 ){
+            fill_span( p, n, color );
+            return;
+        }
+        if( alpha == 128 ){
+            return;
+        }
+        Color on, off;
+        Generic::alpha_blend( ColorRGB( 255, 255, 255 ), color, alpha, on );
+        Generic::alpha_blend( ColorRGB( 0, 0, 0 ), color, alpha, off );
+        const uint8_t pattern_on = row_pattern( luminance( on ), p.dither_row );
+        const uint8_t pattern_off = row_pattern( luminance( off ), p.dither_row );
+        uint8_t *b = p.byte;
+        if( p.bit != 0 && n > 0 ){
+            int m = ( n < 8 - p.bit ) ? n : 8 - p.bit;
+            blend_byte( b, span_mask( p.bit, m ), pattern_on, pattern_off );
+            b++;
+            n -= m;
+        }
+        for( ; n >= 8; n -= 8, b++ ){
+            *b = ( *b & pattern_on ) | ( ~*b & pattern_off );
+        }
+        if( n > 0 ){
+            blend_byte( b, span_mask( 0, n ), pattern_on, pattern_off );
+        }
+    }
+    // The alpha of each pixel (the edges) is blended pixel by pixel. / 画素ごとのalphaは1画素ずつ
+    static inline void blend_span( const Pointer &p, const uint8_t *alphas, const int n, const Color &color ){
+        Generic::blend_span( p, alphas, n, color );
+    }
+
+    private:
+    static inline uint8_t bit_mask( const uint8_t bit ){
+        return ( ORDER == MSB_FIRST ) ? ( 0x80 >> bit ) : ( 1 << bit );
+    }
+    // the pixels [bit, bit + n) of a byte / バイト内の画素[bit, bit + n)
+    static inline uint8_t span_mask( const int bit, const int n ){
+        uint8_t mask = ( ( 1U << n ) - 1 ) << ( 8 - bit - n );
+        if( ORDER == LSB_FIRST ){
+            mask = ( ( 1U << n ) - 1 ) << bit;
+        }
+        return mask;
+    }
+    static inline void blend_byte( uint8_t *b, const uint8_t mask, const uint8_t pattern_on, const uint8_t pattern_off ){
+        uint8_t v = ( *b & pattern_on ) | ( ~*b & pattern_off );
+        *b = ( *b & ~mask ) | ( v & mask );
+    }
+    // ( 77 * r + 150 * g + 29 * b ) / 256, 255 for white / 輝度
+    static inline uint8_t luminance( const Color &color ){
+        return ( 77 * color.color[0] + 150 * color.color[1] + 29 * color.color[2] ) >> 8;
+    }
+    // the 8 pixels of a byte in the row with the luminance / 行の1バイト分のディザパターン
+    static inline uint8_t row_pattern( const uint8_t l, const uint8_t row ){
+        uint8_t pattern = 0;
+        for( int bit = 0; bit < 8; bit++ ){
+            if( l >= OrderedDither::threshold( bit, row ) ){
+                pattern |= bit_mask( bit );
+            }
+        }
+        return pattern;
+    }
+};
+
+// the left most pixel in the MSB (e-paper controllers, PBM) / 左端の画素が最上位ビット
+typedef PixelFormat1<MSB_FIRST> PixelFormat_Mono;
+// the left most pixel in the LSB (XBM) / 左端の画素が最下位ビット
+typedef PixelFormat1<LSB_FIRST> PixelFormat_Mono_LSB;
+
+/*==============================================================//
+class PixelFormatIndexed
+    BITS (4 or 8) bits per pixel, the index of a color in a Palette.
+    The Color is ColorIndex, so the drawing functions take the index of
+    the color. The left pixel is in the upper bits of a byte (4 bits).
+    The face colors of pictures and the colors of gradients are 8-bit RGB
+    and drawn with the nearest color of the palette.
+    インデックスカラー(4bitまたは8bit)。描画関数には色番号を渡す。
+    ピクチャとグラデーションの色は8bit RGBで、パレットの最も近い色で描く。
+
+    The palette is set by set_palette() and shared by the canvases of
+    the format. Give another PALETTE_ID for canvases of another palette.
+    The palette must be set before drawing, and all indices in the
+    pixels must be less than Palette::size().
+    パレットは同じ形式のキャンバスで共有する。別のパレットはPALETTE_IDで分ける。
+
+    The blends are looked up in the blend table of the Palette: a span
+    of a constant alpha is one lookup of a byte per pixel (two per byte
+    for 4 bits). The RGB colors are only made by Color_to_RGB888, e.g.
+    while the rows are converted to RGB565 for the display
+    (Canvas::convert_rows).
+    A palette of more than Palette::n_max_table_colors (32) colors has no
+    table, and each blended pixel searches the nearest color (slower).
+    合成はパレットの合成表を引く。RGBへの変換は表示器への送信時のみ。
+    32色より多いパレットは表がなく、画素ごとに最も近い色を探す(遅い)。
+//==============================================================*/
+template <uint8_t BITS, int PALETTE_ID = 0>
+class PixelFormatIndexed : public PixelSpans< PixelFormatIndexed<BITS, PALETTE_ID> >{
+    typedef PixelSpans< PixelFormatIndexed<BITS, PALETTE_ID> > Generic;
+    static_assert( BITS == 4 || BITS == 8, "4 or 8 bits per pixel" );
+    public:
+    typedef ColorIndex Color;
+    static const unsigned int bytes_per_pixel = ( BITS == 8 ) ? 1 : 0; // 0: less than a byte / 1バイト未満
+    static const unsigned int bits_per_pixel = BITS;
+    static const int pixels_per_byte = 8 / BITS;
+    struct Pointer{
+        uint8_t *byte;
+        uint8_t pixel; // the position in the byte, 0: the left pixel / バイト内の位置(0が左)
+    };
+
+    //================
+    // Functions / 関数
+    //================
+    static inline void set_palette( const Palette &palette ){ palette_pointer() = &palette; }
+    static inline const Palette &palette(){ return *palette_pointer(); }
+
+    static inline Pointer pixel_pointer( uint8_t *row, const int x, const int ){
+        Pointer p;
+        p.byte = row + x / pixels_per_byte;
+        p.pixel = x % pixels_per_byte;
+        return p;
+    }
+    static inline Pointer advance( Pointer p, const int n ){
+        int pixel = p.pixel + n;
+        p.byte += pixel / pixels_per_byte;
+        p.pixel = pixel % pixels_per_byte;
+        return p;
+    }
+    static constexpr unsigned int row_bytes( const unsigned int width ){
+        return ( width + pixels_per_byte - 1 ) / pixels_per_byte;
+    }
+
+    static inline void get_Color( const Pointer &p, Color &color ){
+        color.color[0] = ( *p.byte >> shift( p.pixel ) ) & index_mask;
+    }
+    static inline void set_Color( const Pointer &p, const Color &color ){
+        *p.byte = ( *p.byte & ~( index_mask << shift( p.pixel ) ) ) | ( color.color[0] << shift( p.pixel ) );
+    }
+    static inline void Color_to_RGB888( const Color &color, uint8_t &r8, uint8_t &g8, uint8_t &b8 ){
+        const ColorRGB &c = palette().get_color( color.color[0] );
+        r8 = c.color[0];
+        g8 = c.color[1];
+        b8 = c.color[2];
+    }
+    // the nearest color of the palette / パレットの最も近い色
+    static inline void RGB888_to_Color( const uint8_t r8, const uint8_t g8, const uint8_t b8, Color &color ){
+        color.color[0] = palette().nearest( r8, g8, b8 );
+    }
+    // The colors of pictures and gradients are 8-bit RGB for an indexed canvas / ピクチャ、グラデーションの色は8bit RGB
+    static inline void ColorRGB_to_Color( const ColorRGB &rgb, Color &color ){
+        RGB888_to_Color( rgb.color[0], rgb.color[1], rgb.color[2], color );
+    }
+    // by the blend table, alpha > 128 is the same as 128 / 合成表を引く
+    static inline void alpha_blend( const Color &color_org, const Color &color_cur, const uint8_t alpha, Color &new_color ){
+        new_color.color[0] = palette().blend( color_org.color[0], color_cur.color[0], alpha );
+    }
+
+    //================
+    // Span functions / スパン関数
+    //================
+    static inline void fill_span( Pointer p, int n, const Color &color ){
+        for( ; p.pixel != 0 && n > 0; n-- ){
+            set_Color( p, color );
+            p = advance( p, 1 );
+        }
+        memset( p.byte, color.color[0] * ( 0xFF / index_mask ), n / pixels_per_byte );
+        p.byte += n / pixels_per_byte;
+        for( int i = 0; i < n % pixels_per_byte; i++ ){
+            p.pixel = i;
+            set_Color( p, color );
+        }
+    }
+    // A whole byte is blended by the row of the blend table for the color and the alpha.
+    // 色とalphaで決まる合成表の1行でバイト単位に変換する
+    static inline void blend_span( Pointer p, int n, const Color &color, const uint8_t alpha ){
+        if( alpha == 0 ){
+            fill_span( p, n, color );
+            return;
+        }
+        if( alpha >= 128 ){
+            return;
+        }
+        const uint8_t *lut = palette().blend_row( color.color[0], alpha );
+        if( lut == NULL ){
+            // no blend table (a large palette) / 合成表がない
+            Generic::blend_span( p, n, color, alpha );
+            return;
+        }
+        Color c;
+        for( ; p.pixel != 0 && n > 0; n-- ){
+            get_Color( p, c );
+            c.color[0] = lut[ c.color[0] ];
+            set_Color( p, c );
+            p = advance( p, 1 );
+        }
+        uint8_t *b = p.byte;
+        for( int i = 0; i < n / pixels_per_byte; i++ ){
+            if( BITS == 8 ){
+                b[i] = lut[ b[i] ];
+            }else{
+                b[i] = ( lut[ b[i] >> 4 ] << 4 ) | lut[ b[i] & 0x0F ];
+            }
+        }
+        p.byte += n / pixels_per_byte;
+        for( int i = 0; i < n % pixels_per_byte; i++ ){
+            p.pixel = i;
+            get_Color( p, c );
+            c.color[0] = lut[ c.color[0] ];
+            set_Color( p, c );
+        }
+    }
+    // The alpha of each pixel (the edges) is looked up pixel by pixel. / 画素ごとのalphaは1画素ずつ
+    static inline void blend_span( const Pointer &p, const uint8_t *alphas, const int n, const Color &color ){
+        Generic::blend_span( p, alphas, n, color );
+    }
+
+    private:
+    static const unsigned int index_mask = ( 1U << BITS ) - 1;
+    static inline int shift( const uint8_t pixel ){ return ( pixels_per_byte - 1 - pixel ) * BITS; }
+    static inline const Palette *&palette_pointer(){
+        static const Palette *p = NULL;
+        return p;
+    }
+};
+
+typedef PixelFormatIndexed<4> PixelFormat_Indexed4;
+typedef PixelFormatIndexed<8> PixelFormat_Indexed8;
+
+#endif
@@ -1,11 +1,33 @@
 #include "Polygon2D.hpp"
 #include <cmath>
+#include <algorithm>
 
 #include "debug_functions.hpp"
 
 Polygon2D::Polygon2D(){
-    // nothing
     // is_convexは、点の追加時や図形定義時点で代入する。
+    this->edge_table_is_valid = false;
+    this->edge_storage = NULL;
+    this->n_edge_capacity = 0;
+    this->edge_storage_is_in_arena = false;
+    this->arena = NULL;
+    this->convex_pieces_is_valid = false;
+    this->contour_starts.push_back(0);
+    this->fill_rule = EVEN_ODD;
+}
+
+Polygon2D::Polygon2D( const Polygon2D &p ){
+    this->edge_table_is_valid = false;
+    this->edge_storage = NULL;
+    this->n_edge_capacity = 0;
+    this->edge_storage_is_in_arena = false;
+    this->arena = NULL;
+    this->convex_pieces_is_valid = false;
+    *this = p;
+}
+
+Polygon2D::~Polygon2D(){
+    release_edge_storage();
 }
 
 // 凸形状かを判定する際に使用するサブ関数
@@ -29,6 +51,309 @@ void Polygon2D::check_convex( const uint16_t index0, const uint16_t index1, cons
 void Polygon2D::clear(){
     this->is_convex = false;
     this->vertices.clear();
+    this->contour_starts.clear();
+    this->contour_starts.push_back(0);
+    invalidate_caches();
+}
+
+void Polygon2D::set_arena( FrameArena *arena ){
+    this->vertices.set_arena( arena );
+    this->contour_starts.set_arena( arena );
+    this->arena = arena;
+}
+
+// 新しい輪郭の開始。現在の輪郭が空なら何もしない。
+// 複数の輪郭を持つポリゴンは凸ではない。
+void Polygon2D::begin_contour(){
+    uint16_t n_points = this->vertices.size();
+    if( n_points == 0 || this->contour_starts.back() == n_points ){
+        return;
+    }
+    this->contour_starts.push_back( n_points );
+    this->is_convex = false;
+    invalidate_caches();
+}
+
+void Polygon2D::add_contour( const Polygon2D &p, const bool inversely ){
+    for( uint16_t c = 0; c < p.n_contours(); c++ ){
+        begin_contour();
+        uint16_t s = p.contour_start(c);
+        uint16_t e = p.contour_end(c);
+        for( uint16_t n = s; n < e; n++ ){
+            this->add_Point2D( p.vertices[ inversely ? e - 1 - ( n - s ) : n ] );
+        }
+    }
+}
+
+// 辺テーブルの作成
+// 水平な辺は交差しないので登録しない。
+void Polygon2D::build_edge_table() const{
+    // 辺の数は頂点の数以下。足りなければ領域を取り直す
+    const uint16_t n_max_edges = this->vertices.size();
+    if( n_max_edges > this->n_edge_capacity ){
+        release_edge_storage();
+        // 4 arrays of coordinate_t, then dxdy and dir (in the order of the alignment) / アラインメントの大きい順に並べる
+        const size_t n_bytes = n_max_edges * ( 4 * sizeof( coordinate_t ) + sizeof( float ) + sizeof( int8_t ) );
+        if( this->arena != NULL ){
+            this->edge_storage = this->arena->allocate( n_bytes, alignof( coordinate_t ) );
+        }
+        this->edge_storage_is_in_arena = ( this->edge_storage != NULL );
+        if( this->edge_storage == NULL ){
+            this->edge_storage = ::operator new( n_bytes );
+        }
+        this->n_edge_capacity = n_max_edges;
+    }
+    coordinate_t *y_min = static_cast<coordinate_t*>( this->edge_storage );
+    coordinate_t *y_max = y_min + this->n_edge_capacity;
+    coordinate_t *x_at_y_min = y_max + this->n_edge_capacity;
+    coordinate_t *x_at_y_max = x_at_y_min + this->n_edge_capacity;
+    float *dxdy = reinterpret_cast<float*>( x_at_y_max + this->n_edge_capacity );
+    int8_t *dir = reinterpret_cast<int8_t*>( dxdy + this->n_edge_capacity );
+
+    uint16_t n_edges = 0;
+    for( uint16_t c = 0; c < this->contour_starts.size(); c++ ){
+        uint16_t s = contour_start(c);
+        uint16_t e = contour_end(c);
+        for( uint16_t n = s; n < e; n++ ){
+            // 輪郭ごとに閉じる
+            const Point2D &p0 = this->vertices[n];
+            const Point2D &p1 = this->vertices[( n + 1 < e ) ? n + 1 : s];
+            if( p0.y == p1.y ){
+                continue;
+            }
+            dxdy[n_edges] = static_cast<float>( p1.x - p0.x ) / ( p1.y - p0.y );
+            if( p0.y < p1.y ){
+                y_min[n_edges] = p0.y;
+                y_max[n_edges] = p1.y;
+                x_at_y_min[n_edges] = p0.x;
+                dir[n_edges] = 1;
+            }else{
+                y_min[n_edges] = p1.y;
+                y_max[n_edges] = p0.y;
+                x_at_y_min[n_edges] = p1.x;
+                dir[n_edges] = -1;
+            }
+            // 下端での交点。下端をcrossing_shiftだけずらして補間する(以前の判定と同じ計算)
+            coordinate_t y_max_of_edge = ( p0.y < p1.y ) ? p1.y : p0.y;
+            coordinate_t y0 = p0.y;
+            coordinate_t y1 = p1.y;
+            if( y0 == y_max_of_edge ) y0 += crossing_shift;
+            if( y1 == y_max_of_edge ) y1 += crossing_shift;
+            x_at_y_max[n_edges] = ( ( p1.x - p0.x ) * ( y_max_of_edge - y0 ) ) / ( y1 - y0 ) + p0.x;
+            n_edges++;
+        }
+    }
+    this->edge_table.n_edges = n_edges;
+    this->edge_table.y_min = y_min;
+    this->edge_table.y_max = y_max;
+    this->edge_table.x_at_y_min = x_at_y_min;
+    this->edge_table.x_at_y_max = x_at_y_max;
+    this->edge_table.dxdy = dxdy;
+    this->edge_table.dir = dir;
+    this->edge_table_is_valid = true;
+}
+
+void Polygon2D::release_edge_storage() const{
+    if( this->edge_storage != NULL && !this->edge_storage_is_in_arena ){
+        ::operator delete( this->edge_storage );
+    }
+    this->edge_storage = NULL;
+    this->n_edge_capacity = 0;
+    this->edge_storage_is_in_arena = false;
+    this->edge_table_is_valid = false;
+}
+
+Polygon2D::EdgeTable Polygon2D::get_edge_table() const{
+    if( !this->edge_table_is_valid ){
+        build_edge_table();
+    }
+    return this->edge_table;
+}
+
+const std::vector<Polygon2D> &Polygon2D::get_convex_pieces() const{
+    if( !this->convex_pieces_is_valid ){
+        build_convex_pieces();
+    }
+    return this->convex_pieces;
+}
+
+// 凸分割のためのサブ関数
+// 3点a->b->cの外積。左回り(y下向きの画面では時計回り)で正
+static inline coordinate_sq_t turn( const Point2D &a, const Point2D &b, const Point2D &c ){
+    return static_cast<coordinate_sq_t>( b.x - a.x ) * ( c.y - b.y ) - static_cast<coordinate_sq_t>( b.y - a.y ) * ( c.x - b.x );
+}
+static inline int sign_of( const coordinate_sq_t v ){
+    return ( v > 0 ) ? 1 : ( ( v < 0 ) ? -1 : 0 );
+}
+// 線分p0-p1とq0-q1が交差(接触を含む)するか
+static bool segments_intersect( const Point2D &p0, const Point2D &p1, const Point2D &q0, const Point2D &q1 ){
+    int d0 = sign_of( turn( p0, p1, q0 ) );
+    int d1 = sign_of( turn( p0, p1, q1 ) );
+    int d2 = sign_of( turn( q0, q1, p0 ) );
+    int d3 = sign_of( turn( q0, q1, p1 ) );
+    if( d0 * d1 < 0 && d2 * d3 < 0 ){
+        return true;
+    }
+    // 同一直線上で重なる場合
+    if( d0 == 0 && d1 == 0 ){
+        coordinate_t p_min_x = std::min( p0.x, p1.x ), p_max_x = std::max( p0.x, p1.x );
+        coordinate_t p_min_y = std::min( p0.y, p1.y ), p_max_y = std::max( p0.y, p1.y );
+        coordinate_t q_min_x = std::min( q0.x, q1.x ), q_max_x = std::max( q0.x, q1.x );
+        coordinate_t q_min_y = std::min( q0.y, q1.y ), q_max_y = std::max( q0.y, q1.y );
+        return p_min_x <= q_max_x && q_min_x <= p_max_x && p_min_y <= q_max_y && q_min_y <= p_max_y;
+    }
+    // 端点が他方の線分上にある場合
+    if( ( d0 == 0 || d1 == 0 ) && d2 * d3 < 0 ) return true;
+    if( ( d2 == 0 || d3 == 0 ) && d0 * d1 < 0 ) return true;
+    return false;
+}
+
+// 耳刈り取り法で三角形に分割し、凸性を保てる対角線を取り除いて三角形を併合する(Hertel-Mehlhorn)。
+// 一直線に並ぶ点は面積を持たないので、耳刈り取りの途中で取り除く。
+// 単純多角形でない(辺が交差する)場合や、分割に失敗した場合は空のまま。
+void Polygon2D::build_convex_pieces() const{
+    this->convex_pieces.clear();
+    this->convex_pieces_is_valid = true;
+    uint16_t np = this->vertices.size();
+    if( this->is_convex || this->contour_starts.size() > 1 || np < 4 ){
+        return;
+    }
+    const SmallVector<Point2D, n_inline_vertices> &v = this->vertices;
+
+    // 単純多角形か(隣り合わない辺が交差しないか)
+    for( uint16_t a = 0; a < np; a++ ){
+        for( uint16_t b = a + 2; b < np; b++ ){
+            if( a == 0 && b == np - 1 ){
+                continue;
+            }
+            if( segments_intersect( v[a], v[a+1], v[b], v[(b+1)%np] ) ){
+                return;
+            }
+        }
+    }
+    // 向き
+    coordinate_sq_t area2 = 0;
+    for( uint16_t n = 0; n < np; n++ ){
+        const Point2D &p0 = v[n];
+        const Point2D &p1 = v[(n+1)%np];
+        area2 += static_cast<coordinate_sq_t>( p0.x ) * p1.y - static_cast<coordinate_sq_t>( p1.x ) * p0.y;
+    }
+    int orientation = sign_of( area2 );
+    if( orientation == 0 ){
+        return;
+    }
+
+    // 耳刈り取り
+    std::vector< std::vector<uint16_t> > pieces;
+    std::vector<uint16_t> remaining( np );
+    for( uint16_t n = 0; n < np; n++ ){
+        remaining[n] = n;
+    }
+    while( remaining.size() > 3 ){
+        uint16_t m = remaining.size();
+        bool found = false;
+        for( uint16_t k = 0; k < m && !found; k++ ){
+            uint16_t ip = remaining[(k+m-1)%m];
+            uint16_t ic = remaining[k];
+            uint16_t in = remaining[(k+1)%m];
+            int t = sign_of( turn( v[ip], v[ic], v[in] ) ) * orientation;
+            if( t < 0 ){
+                continue; // 凹頂点
+            }
+            if( t > 0 ){
+                // 他の頂点が三角形の中(辺上を含む)にあれば耳ではない
+                for( uint16_t q = 0; q < m; q++ ){
+                    const Point2D &pq = v[remaining[q]];
+                    if( pq == v[ip] || pq == v[ic] || pq == v[in] ){
+                        continue;
+                    }
+                    if( sign_of( turn( v[ip], v[ic], pq ) ) * orientation >= 0
+                     && sign_of( turn( v[ic], v[in], pq ) ) * orientation >= 0
+                     && sign_of( turn( v[in], v[ip], pq ) ) * orientation >= 0 ){
+                        t = -1;
+                        break;
+                    }
+                }
+                if( t < 0 ){
+                    continue;
+                }
+                std::vector<uint16_t> triangle( 3 );
+                triangle[0] = ip;
+                triangle[1] = ic;
+                triangle[2] = in;
+                pieces.push_back( triangle );
+            }
+            // 耳(または一直線に並ぶ点)を取り除く
+            remaining.erase( remaining.begin() + k );
+            found = true;
+        }
+        if( !found ){
+            return;
+        }
+    }
+    if( sign_of( turn( v[remaining[0]], v[remaining[1]], v[remaining[2]] ) ) != 0 ){
+        pieces.push_back( remaining );
+    }
+
+    // 共有する辺で隣り合う2つのピースを、凸のままなら併合する
+    bool merged = true;
+    while( merged ){
+        merged = false;
+        for( uint16_t a = 0; a < pieces.size() && !merged; a++ ){
+            for( uint16_t b = a + 1; b < pieces.size() && !merged; b++ ){
+                const std::vector<uint16_t> &pa = pieces[a];
+                const std::vector<uint16_t> &pb = pieces[b];
+                for( uint16_t i = 0; i < pa.size() && !merged; i++ ){
+                    uint16_t u = pa[i];
+                    uint16_t w = pa[(i+1)%pa.size()];
+                    for( uint16_t j = 0; j < pb.size(); j++ ){
+                        if( pb[j] != w || pb[(j+1)%pb.size()] != u ){
+                            continue;
+                        }
+                        // paをwから一周(w...u)し、pbをuの次からwの前まで続ける
+                        std::vector<uint16_t> candidate;
+                        for( uint16_t k = 0; k < pa.size(); k++ ){
+                            candidate.push_back( pa[(i+1+k)%pa.size()] );
+                        }
+                        for( uint16_t k = 2; k < pb.size(); k++ ){
+                            candidate.push_back( pb[(j+k)%pb.size()] );
+                        }
+                        bool convex = true;
+                        uint16_t nc = candidate.size();
+                        for( uint16_t k = 0; k < nc && convex; k++ ){
+                            if( sign_of( turn( v[candidate[(k+nc-1)%nc]], v[candidate[k]], v[candidate[(k+1)%nc]] ) ) * orientation < 0 ){
+                                convex = false;
+                            }
+                        }
+                        if( convex ){
+                            pieces[a] = candidate;
+                            pieces.erase( pieces.begin() + b );
+                            merged = true;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // ポリゴンを作る。凸判定のため、2点目が一直線上にない頂点になるように始点をずらす
+    this->convex_pieces.resize( pieces.size() );
+    for( uint16_t n = 0; n < pieces.size(); n++ ){
+        const std::vector<uint16_t> &piece = pieces[n];
+        uint16_t nc = piece.size();
+        uint16_t start = 0;
+        while( start < nc && sign_of( turn( v[piece[start]], v[piece[(start+1)%nc]], v[piece[(start+2)%nc]] ) ) == 0 ){
+            start++;
+        }
+        for( uint16_t k = 0; k < nc; k++ ){
+            this->convex_pieces[n].add_Point2D( v[piece[(start+k)%nc]] );
+        }
+        if( !this->convex_pieces[n].is_convex_polygon() ){
+            this->convex_pieces.clear();
+            return;
+        }
+    }
 }
 
 // 点の追加。bounding boxと、is_convexの更新
@@ -60,6 +385,7 @@ void Polygon2D::add_Point2D( const Point2D p ){
     }
     // 追加
     this->vertices.push_back(p);
+    invalidate_caches();
     // 追加後の数
     n_points = this->vertices.size();
     // 凸判定
@@ -71,7 +397,10 @@ void Polygon2D::add_Point2D( const Point2D p ){
     //  すでに凸でない部分があれば、判定が覆ることがないためスキップする。
     //  N点目が追加された時、以下の3つで外積の継続性を判定
     //  {N-2, N-1, N}, {N-1, N, 0}, {N-1, 0, 1}
-    if( n_points == 3 ){
+    // 複数の輪郭を持つ時は凸ではない。
+    if( this->contour_starts.size() > 1 ){
+        this->is_convex = false;
+    }else if( n_points == 3 ){
         Point2D v0 = this->vertices[1] - this->vertices[0];
         Point2D v1 = this->vertices[2] - this->vertices[1];
         coordinate_sq_t outer_product = v0.x * v1.y - v0.y * v1.x;
@@ -169,78 +498,29 @@ Point2D Polygon2D::get_Point2D(const uint16_t index) const{
     return vertices[index];
 }
 
-// 点(x,y)から右に伸ばした半直線が、線分[p0,p1)と交差するかどうかを判定
-// 交差する時はそのx座標をx_cross_pointに代入。
-// 交差しない時は未定
-// 計算量削減のため、p0.yあるいはp1.yがyと同じ場合は、y座標を少しずらす
-bool Polygon2D::is_crossing( const coordinate_t x, const coordinate_t y, const Point2D &p0, const Point2D &p1, coordinate_t *x_cross_point ) const{
-
-    // わかりやすいケースから早期リターン
-    // case 0
-    // xが、p0.xとp1.xよりも大きければそもそも右側にないので交差しない
-    if(( p0.x < x ) && ( p1.x < x )){
-        return false;
-    }
-
-    // 水平線は、この後の計算量削減処理によって絶対交差しない
-    if( p0.y == p1.y ){
-        return false;
-    }
-
-    // 計算量削減のため、p0.yやp1.yがyと一致するときは、一律少しずらす。
-    float y0 = p0.y;
-    float y1 = p1.y;
-#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
-    if( y0 == y ) y0 += 0.005; 
-    if( y1 == y ) y1 += 0.005; 
-#else
-    if( y0 == y ) y0 += 1; 
-    if( y1 == y ) y1 += 1; 
-#endif
-    // case 1
-    // y座標が2点の間になければ交差しない
-    if( ( y0 - y ) * ( y1 - y) > 0 ){
-        return false;
-    }
-
-    // 交点算出
-    coordinate_t x_cross_point_temp = ((p1.x - p0.x) * (y - y0)) / (y1 - y0) + p0.x; 
-    if( x_cross_point != NULL ){
-        *x_cross_point = x_cross_point_temp;
-    }
-    // 交点のx座標が2点の間にあるか？
-    // 交点が右側にあるか?
-    if( x <= x_cross_point_temp ){
-        return true;
-    }else{
-        return false;
-    }
-}
-
 // 点x, yがポリゴンの中かエッジ上にある場合にtrue, ない時はfalse
 // 呼び出し側の計算量削減のため、最も左にある交差点のx座標を代入する
 bool Polygon2D::is_the_point_inside(const coordinate_t x, const coordinate_t y, coordinate_t &first_crossing_point_X ) const{
-    bool ret_val = false;
-    Point2D p0 = this->vertices[0];
-    int np = this->vertices.size();
+    if( !this->edge_table_is_valid ){
+        build_edge_table();
+    }
+    // 右側にある交点の数(EVEN_ODD)、または向きの和(NON_ZERO)で判定
+    int n_crossings = 0;
+    int winding = 0;
+    uint16_t n_edges = this->edge_table.n_edges;
     coordinate_t crossing_point_X;
-    for(int n = 1; n < np; n++){
-        Point2D p1 = this->vertices[n];
-        if( is_crossing( x, y, p0, p1, &crossing_point_X ) ){
-            ret_val = !ret_val;
+    for( uint16_t e = 0; e < n_edges; e++ ){
+        // 交点が右側にあるか?
+        if( edge_crossing( e, y, crossing_point_X ) && x <= crossing_point_X ){
+            n_crossings++;
+            winding += this->edge_table.dir[e];
             if( first_crossing_point_X > crossing_point_X ) first_crossing_point_X = crossing_point_X;
         }
-        p0 = p1;
     }
-    {
-        Point2D p1 = this->vertices[0];
-        if( is_crossing( x, y, p0, p1, &crossing_point_X ) ){
-            ret_val = !ret_val;
-            if( first_crossing_point_X > crossing_point_X ) first_crossing_point_X = crossing_point_X;
-        }
+    if( this->fill_rule == NON_ZERO ){
+        return winding != 0;
     }
-
-    return ret_val;
+    return ( n_crossings & 1 ) != 0;
 }
 
 /*
@@ -276,46 +556,7 @@ float Polygon2D::compute_covered_area(const pixel_index_t ix, const pixel_index_
 */
 
 void Polygon2D::compute_covered_areas(const pixel_index_t iy, const pixel_index_t start_x, const pixel_index_t end_x, uint8_t *areas ) const{
-
-    // zero clear the areas
-    for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
-        areas[(ix-start_x)] = 0U;        
-    }
-
-
-    for(int j = 0; j < n_divides; j++){
-        coordinate_t y = iy * internal_scale + init_pos + delta_pos * j;
-        coordinate_t first_cross_point_X = end_x * internal_scale + 1;
-        bool first_judge = true;
-        bool former_result = false;
-
-        for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
-            for( int i = 0; i < n_divides; i++){
-                coordinate_t x = ix * internal_scale +  init_pos + delta_pos * i;
-                // 交点が左側にある時は調べ直す必要があるので、交点をリセットしてフラグを立てる。
-                if( x > first_cross_point_X ){
-                    first_cross_point_X = end_x * internal_scale + 1;
-                    first_judge = true;
-                }
-                // 最初の交点が調べたい点よりも右側の場合は、判定が変わらずし直す必要がないので、チェック
-                if( x <= first_cross_point_X && first_judge == false ){
-                //if( x <= first_cross_point_X ){
-                    // 再判定必要なし。
-                    if( former_result ){
-                        areas[ix-start_x]++;
-                    }
-                }else{
-                    // 再判定必要あり
-                    former_result = is_the_point_inside(x,y, first_cross_point_X);
-                    first_judge = false;
-                    if( former_result ){
-                        areas[ix-start_x]++;
-                    }
-                }
-            }
-        }
-    }
-    return;
+    compute_covered_areas<DefaultSamplingPattern>( iy, start_x, end_x, areas );
 }
 
 
@@ -341,33 +582,21 @@ void Polygon2D::get_sx_mix_and_out( const pixel_index_t iy, pixel_index_t &sx_mi
 
     // y-0.5fと、y+0.5fの２つで調べる
     // floatで座標を求めておき、floorとceil
-    int np = this->vertices.size();
+    if( !this->edge_table_is_valid ){
+        build_edge_table();
+    }
+    uint16_t n_edges = this->edge_table.n_edges;
     coordinate_t y = iy * internal_scale;
     // 初期化
     coordinate_t sx_mix_temp = this->maxX - internal_scale;
     coordinate_t sx_out_temp = this->minX + internal_scale;
-    Point2D p0 = this->vertices[0];
-    for( int n = 1; n < np ; n++ ){
-        Point2D p1 = this->vertices[n];
-        coordinate_t x_crossing_point;
-        if( is_crossing( this->minX-internal_scale, y-half_internal_scale, p0, p1, &x_crossing_point ) ){
-            if( sx_mix_temp > x_crossing_point ) sx_mix_temp = x_crossing_point;
-            if( sx_out_temp < x_crossing_point ) sx_out_temp = x_crossing_point;
-        }
-        if( is_crossing( this->minX-internal_scale, y+half_internal_scale, p0, p1, &x_crossing_point ) ){
-            if( sx_mix_temp > x_crossing_point ) sx_mix_temp = x_crossing_point;
-            if( sx_out_temp < x_crossing_point ) sx_out_temp = x_crossing_point;
-        }
-        p0 = p1;
-    }
-    {
-        Point2D p1 = this->vertices[0];
+    for( uint16_t e = 0; e < n_edges; e++ ){
         coordinate_t x_crossing_point;
-        if( is_crossing( this->minX-internal_scale, y-half_internal_scale, p0, p1, &x_crossing_point ) ){
+        if( edge_crossing( e, y-half_internal_scale, x_crossing_point ) ){
             if( sx_mix_temp > x_crossing_point ) sx_mix_temp = x_crossing_point;
             if( sx_out_temp < x_crossing_point ) sx_out_temp = x_crossing_point;
         }
-        if( is_crossing( this->minX-internal_scale, y+half_internal_scale, p0, p1, &x_crossing_point ) ){
+        if( edge_crossing( e, y+half_internal_scale, x_crossing_point ) ){
             if( sx_mix_temp > x_crossing_point ) sx_mix_temp = x_crossing_point;
             if( sx_out_temp < x_crossing_point ) sx_out_temp = x_crossing_point;
         }
@@ -392,39 +621,53 @@ void Polygon2D::get_start_x_of_the_areas( const pixel_index_t iy, pixel_index_t
     
     // y-0.5fと、y+0.5fの２つで調べる
     // floatで座標を求めておき、floorとceil
-    int np = this->vertices.size();
+    if( !this->edge_table_is_valid ){
+        build_edge_table();
+    }
+    uint16_t n_edges = this->edge_table.n_edges;
     coordinate_t y = iy * internal_scale;
     // 初期化
     coordinate_t sx_mix0_temp = this->maxX + internal_scale; // for y - 0.5
     coordinate_t sx_out0_temp = this->minX - internal_scale; // for y - 0.5
     coordinate_t sx_mix1_temp = this->maxX + internal_scale; // for y + 0.5
     coordinate_t sx_out1_temp = this->minX - internal_scale; // for y + 0.5
-    Point2D p0 = this->vertices[0];
-    for( int n = 1; n < np ; n++ ){
-        Point2D p1 = this->vertices[n]; // あえて n%npにしない。
+    coordinate_t vx_min = this->maxX + internal_scale; // vertices between y - 0.5 and y + 0.5
+    coordinate_t vx_max = this->minX - internal_scale;
+    for( uint16_t e = 0; e < n_edges; e++ ){
         coordinate_t x_crossing_point;
-        if( is_crossing( this->minX-internal_scale, y - half_internal_scale, p0, p1, &x_crossing_point ) ){
+        if( edge_crossing( e, y - half_internal_scale, x_crossing_point ) ){
             if( sx_mix0_temp > x_crossing_point ) sx_mix0_temp = x_crossing_point;
             if( sx_out0_temp < x_crossing_point ) sx_out0_temp = x_crossing_point;
         }
-        if( is_crossing( this->minX-internal_scale, y + half_internal_scale, p0, p1, &x_crossing_point ) ){
+        if( edge_crossing( e, y + half_internal_scale, x_crossing_point ) ){
             if( sx_mix1_temp > x_crossing_point ) sx_mix1_temp = x_crossing_point;
             if( sx_out1_temp < x_crossing_point ) sx_out1_temp = x_crossing_point;
         }
-        p0 = p1;
+        // 行の中(y-0.5とy+0.5の間)の頂点 (交点より外に出る画素も混合領域にする)
+        if( y - half_internal_scale < this->edge_table.y_min[e] && this->edge_table.y_min[e] < y + half_internal_scale ){
+            if( vx_min > this->edge_table.x_at_y_min[e] ) vx_min = this->edge_table.x_at_y_min[e];
+            if( vx_max < this->edge_table.x_at_y_min[e] ) vx_max = this->edge_table.x_at_y_min[e];
+        }
+        if( y - half_internal_scale < this->edge_table.y_max[e] && this->edge_table.y_max[e] < y + half_internal_scale ){
+            if( vx_min > this->edge_table.x_at_y_max[e] ) vx_min = this->edge_table.x_at_y_max[e];
+            if( vx_max < this->edge_table.x_at_y_max[e] ) vx_max = this->edge_table.x_at_y_max[e];
+        }
     }
-    {
-        Point2D p1 = this->vertices[0];
-        coordinate_t x_crossing_point;
-        if( is_crossing( this->minX-internal_scale, y - half_internal_scale, p0, p1, &x_crossing_point ) ){
-            if( sx_mix0_temp > x_crossing_point ) sx_mix0_temp = x_crossing_point;
-            if( sx_out0_temp < x_crossing_point ) sx_out0_temp = x_crossing_point;
+    // A vertex outside the crossings moves the smaller (larger) crossing, so the order of the areas is kept.
+    // 交点より外側の頂点は、小さい方(大きい方)の交点を置き換える(領域の順序は変わらない)
+    if( vx_min < sx_mix0_temp && vx_min < sx_mix1_temp ){
+        if( sx_mix0_temp < sx_mix1_temp ){
+            sx_mix0_temp = vx_min;
+        }else{
+            sx_mix1_temp = vx_min;
         }
-        if( is_crossing( this->minX-internal_scale, y + half_internal_scale, p0, p1, &x_crossing_point ) ){
-            if( sx_mix1_temp > x_crossing_point ) sx_mix1_temp = x_crossing_point;
-            if( sx_out1_temp < x_crossing_point ) sx_out1_temp = x_crossing_point;
+    }
+    if( vx_max > sx_out0_temp && vx_max > sx_out1_temp ){
+        if( sx_out0_temp > sx_out1_temp ){
+            sx_out0_temp = vx_max;
+        }else{
+            sx_out1_temp = vx_max;
         }
-
     }
 //std::cout << "DEBUG::y-m0-o0-m1-o1:" << y << " " << sx_mix0_temp << " " << sx_out0_temp << " " << sx_mix1_temp << " " << sx_out1_temp << std::endl;
     if( sx_mix0_temp > sx_out0_temp && sx_mix1_temp > sx_out1_temp ){
@@ -577,9 +820,12 @@ void Polygon2D::get_start_x_of_the_areas( const pixel_index_t iy, pixel_index_t
 
 void Polygon2D::print() const{
 #ifndef ESP32    
-    for(int i = 0; i < this->vertices.size(); i++ ){
-        Point2D p = vertices[i];
-        p.print();
+    for( uint16_t c = 0; c < this->contour_starts.size(); c++ ){
+        if( c > 0 ) debug_println("  contour");
+        for(int i = contour_start(c); i < contour_end(c); i++ ){
+            Point2D p = vertices[i];
+            p.print();
+        }
     }
     if( is_convex ){
         debug_println("  convex");
@@ -591,16 +837,21 @@ void Polygon2D::print() const{
 
 
 // methods
-Polygon2D & Polygon2D::operator = (const Polygon2D p){
+Polygon2D & Polygon2D::operator = (const Polygon2D &p){
+    if( this == &p ){
+        return *this;
+    }
     // vertices
-    this->vertices.resize(p.vertices.size());
-    copy(p.vertices.begin(), p.vertices.end(), this->vertices.begin());
+    this->vertices = p.vertices;
     this->minX = p.minX;
     this->maxX = p.maxX;
     this->minY = p.minY;
     this->maxY = p.maxY;
     this->is_convex = p.is_convex;
     this->sign_of_outer_product = p.sign_of_outer_product;
+    this->contour_starts = p.contour_starts;
+    this->fill_rule = p.fill_rule;
+    invalidate_caches();
     return *this;
 }
 Polygon2D & Polygon2D::operator += (const Point2D p){
@@ -612,6 +863,7 @@ Polygon2D & Polygon2D::operator += (const Point2D p){
     this->maxX += p.x;
     this->minY += p.y;
     this->maxY += p.y;
+    invalidate_caches();
     return *this;
 }
 Polygon2D & Polygon2D::operator -= (const Point2D p){
@@ -623,6 +875,7 @@ Polygon2D & Polygon2D::operator -= (const Point2D p){
     this->maxX -= p.x;
     this->minY -= p.y;
     this->maxY -= p.y;
+    invalidate_caches();
     return *this;
 }
 Polygon2D & Polygon2D::operator *= (const float f){
@@ -651,6 +904,7 @@ Polygon2D & Polygon2D::operator *= (const float f){
     this->minY = (static_cast<int32_t>(this->minY) * f_int) >> 7;
     this->maxY = (static_cast<int32_t>(this->maxY) * f_int) >> 7;
 #endif
+    invalidate_caches();
     return *this;
 }
 Polygon2D & Polygon2D::operator /= (const float f){
@@ -670,6 +924,7 @@ Polygon2D & Polygon2D::operator /= (const float f){
     this->maxX = ( this->maxX - cx ) * f_inv + cx;
     this->minY = ( this->minY - cy ) * f_inv + cy;
     this->maxY = ( this->maxY - cy ) * f_inv + cy;
+    invalidate_caches();
     return *this;
 }
 
@@ -731,6 +986,7 @@ Polygon2D & Polygon2D::rotate_equal( const float deg ){
             if( this->maxY < this->vertices[i].y ) this->maxY = this->vertices[i].y;
         }
     }
+    invalidate_caches();
 
     return *this;
 } 
@@ -762,13 +1018,14 @@ Polygon2D & Polygon2D::rotate_equal( const float cos_t, const float sin_t ){
             if( this->maxY < this->vertices[i].y ) this->maxY = this->vertices[i].y;
         }
     }
+    invalidate_caches();
 
     return *this;
 }
 
 // ポリゴンの結合
 // 凸判定のため、1要素ずつ追加
-void Polygon2D::concat( const Polygon2D p ){
+void Polygon2D::concat( const Polygon2D &p ){
     int np = p.vertices.size();
     for( int n = 0; n < np; n++ ){
         this->add_Point2D(p.get_Point2D(n));        
@@ -777,9 +1034,80 @@ void Polygon2D::concat( const Polygon2D p ){
 
 // ポリゴンの結合
 // 凸判定のため、1要素ずつ追加
-void Polygon2D::concat_inversely( const Polygon2D p ){
+void Polygon2D::concat_inversely( const Polygon2D &p ){
     int np = p.vertices.size();
     for( int n = np-1; n >=0; n-- ){
         this->add_Point2D(p.get_Point2D(n));        
     }
-}
\ No newline at end of file
+}
+// Sutherland-Hodgman法で、矩形の4辺について順に輪郭を切り取る。
+// 交点は矩形の辺の上に揃える(誤差で矩形の外に出ないように)。
+Polygon2D Polygon2D::clip( const coordinate_t x0, const coordinate_t y0, const coordinate_t x1, const coordinate_t y1 ) const{
+    Polygon2D clipped;
+    clip( x0, y0, x1, y1, clipped );
+    return clipped;
+}
+void Polygon2D::clip( const coordinate_t x0, const coordinate_t y0, const coordinate_t x1, const coordinate_t y1, Polygon2D &clipped, FrameArena *arena ) const{
+    clipped.clear();
+    clipped.set_arena( arena );
+    clipped.fill_rule = this->fill_rule;
+    // each side adds a point at most for a convex contour / 凸な輪郭なら1辺で高々1点増える
+    SmallVector<Point2D, n_inline_vertices + 4> buffers[2];
+    buffers[0].set_arena( arena );
+    buffers[1].set_arena( arena );
+    for( uint16_t c = 0; c < this->n_contours(); c++ ){
+        SmallVector<Point2D, n_inline_vertices + 4> *p_in = &buffers[0];
+        SmallVector<Point2D, n_inline_vertices + 4> *p_out = &buffers[1];
+        p_in->assign( this->vertices.begin() + contour_start(c), this->vertices.begin() + contour_end(c) );
+        for( int side = 0; side < 4 && p_in->size() >= 3; side++ ){
+            SmallVector<Point2D, n_inline_vertices + 4> &in = *p_in;
+            SmallVector<Point2D, n_inline_vertices + 4> &out = *p_out;
+            // 矩形の辺までの距離。内側で正
+            // side 0: x >= x0, 1: x <= x1, 2: y >= y0, 3: y <= y1
+            out.clear();
+            uint16_t np = in.size();
+            for( uint16_t n = 0; n < np; n++ ){
+                const Point2D &p = in[n];
+                const Point2D &q = in[(n+1)%np];
+                float dp, dq;
+                switch( side ){
+                    case 0:  dp = p.x - x0; dq = q.x - x0; break;
+                    case 1:  dp = x1 - p.x; dq = x1 - q.x; break;
+                    case 2:  dp = p.y - y0; dq = q.y - y0; break;
+                    default: dp = y1 - p.y; dq = y1 - q.y; break;
+                }
+                if( dp >= 0 ){
+                    out.push_back( p );
+                }
+                if( ( dp >= 0 ) != ( dq >= 0 ) && dp != 0 && dq != 0 ){
+                    float t = dp / ( dp - dq );
+                    Point2D r( p.x + ( q.x - p.x ) * t, p.y + ( q.y - p.y ) * t, true );
+                    switch( side ){
+                        case 0:  r.x = x0; break;
+                        case 1:  r.x = x1; break;
+                        case 2:  r.y = y0; break;
+                        default: r.y = y1; break;
+                    }
+                    out.push_back( r );
+                }
+            }
+            std::swap( p_in, p_out );
+        }
+        // 重複する点を除いて追加
+        SmallVector<Point2D, n_inline_vertices + 4> &in = *p_in;
+        SmallVector<Point2D, n_inline_vertices + 4> &out = *p_out;
+        out.clear();
+        for( uint16_t n = 0; n < in.size(); n++ ){
+            if( !( in[n] == in[(n+1)%in.size()] ) ){
+                out.push_back( in[n] );
+            }
+        }
+        if( out.size() < 3 ){
+            continue;
+        }
+        clipped.begin_contour();
+        for( uint16_t n = 0; n < out.size(); n++ ){
+            clipped.add_Point2D( out[n] );
+        }
+    }
+}
@@ -3,9 +3,16 @@
 /*==============================================================//
 class Polygon2D 
     2D polygon data class / ベクトル描画向け  2次元ポリゴンのデータクラス 
+    A polygon can have several contours (holes, rings, glyphs with counters).
+    Each contour is closed automatically, and the inside is decided by the
+    fill rule (EVEN_ODD or NON_ZERO).
+    複数の輪郭を持てる。各輪郭は自動で閉じ、内外は塗りつぶし規則で決める。
 //==============================================================*/
 #include "resolution.hpp"
 #include "Point2D.hpp"
+#include "SamplingPattern.hpp"
+#include "SmallVector.hpp"
+#include "FrameArena.hpp"
 #include <vector>
 
 class Polygon2D{
@@ -13,8 +20,32 @@ class Polygon2D{
     //================
     // data
     //================
+    public:
+    enum FILL_RULE{
+        EVEN_ODD, // inside if the number of crossing edges is odd
+        NON_ZERO  // inside if the winding number is not zero
+    };
+    // 辺テーブル(読み出し専用)。ポリゴンを変更すると無効になる。
+    struct EdgeTable{
+        uint16_t n_edges;
+        const coordinate_t *y_min;
+        const coordinate_t *y_max;
+        const coordinate_t *x_at_y_min;
+        const coordinate_t *x_at_y_max;
+        const float *dxdy;
+        const int8_t *dir;
+    };
+    // The vertices of a polygon up to this number are stored in the object (no heap allocation).
+    // The hands of the clock and the clipped quads are in it; circle24 is not, and takes its vertices
+    // from the arena (set_arena) or the heap. Small, as the polygons are copied and put on the stack.
+    // この頂点数までは頂点をオブジェクト内に持つ(コピーやスタックに置くので小さくする)
+    static const uint16_t n_inline_vertices = 12;
+
     private:
-    std::vector<Point2D> vertices;
+    SmallVector<Point2D, n_inline_vertices> vertices;
+    // index of the first point of each contour. contour_starts[0] is always 0. / 各輪郭の先頭の点
+    SmallVector<uint16_t, 4> contour_starts;
+    FILL_RULE fill_rule;
     // bounding box
     coordinate_t minX;
     coordinate_t maxX;
@@ -24,17 +55,52 @@ class Polygon2D{
     bool is_convex; 
     int sign_of_outer_product;    // used to determine convex or not
 
+    // edge table / 辺テーブル
+    // Built from the vertices when a crossing query needs it, and invalidated when the polygon is modified.
+    // Horizontal edges are not stored. An edge crosses the line y when y_min < y <= y_max,
+    // and the x of the crossing point is x_at_y_min + ( y - y_min ) * dxdy, except x_at_y_max at y == y_max.
+    // x_at_y_max keeps the crossing of the former rule, which moved the end point on the line by
+    // crossing_shift before interpolating. For a nearly horizontal edge (|dy| < crossing_shift) it is
+    // close to the end at y_min, not the end at y_max, so the shapes render as they did.
+    // y == y_maxの交点は、以前の判定(端点を少しずらしてから補間)と同じ値を使う(ほぼ水平な辺で結果が変わらないように)
+    // 辺ごとの構造体ではなく、要素ごとの配列で持つ(ループをベクトル化しやすくするため)
+    mutable bool edge_table_is_valid;
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    static constexpr double crossing_shift = 0.005;
+#else
+    static constexpr coordinate_t crossing_shift = 1;
+#endif
+    // The arrays are in one block out of the object, taken from the arena or the heap when the table is
+    // built first, and kept (the heap block until the destruction) while the edges fit in it.
+    // 配列はオブジェクト外の1つの領域に置く(初回作成時にアリーナかヒープから確保し、収まる間は使い回す)
+    mutable EdgeTable edge_table;
+    mutable void *edge_storage;
+    mutable uint16_t n_edge_capacity;
+    mutable bool edge_storage_is_in_arena;
+    FrameArena *arena; // NULL: the heap is used / NULLならヒープ
+
+    // convex decomposition / 凸分割
+    // Built when it is requested, and invalidated when the polygon is modified. Empty if the polygon cannot be decomposed.
+    mutable bool convex_pieces_is_valid;
+    mutable std::vector<Polygon2D> convex_pieces;
+
     //================
     // constructor / コンストラクタ
     //================
     public:
     Polygon2D();
+    // The caches and the arena are not copied / キャッシュとアリーナはコピーしない
+    Polygon2D( const Polygon2D &p );
+    ~Polygon2D();
 
     //================
     // constructor / コンストラクタ
     //================
     // methods
     void clear(); // 初期化
+    // Take the edge table and the vertices beyond n_inline_vertices from the arena.
+    // For the temporary polygons of a frame only (see FrameArena). / 一時的なポリゴンの領域をアリーナから確保する
+    void set_arena( FrameArena *arena );
 
     //================
     // Functions / 関数
@@ -45,10 +111,25 @@ class Polygon2D{
     // 渡されるindexのチェックは省くので、呼び出し側が注意
     void check_convex( const uint16_t index0, const uint16_t index1, const uint16_t index2 );
 
-    // 点(x,y)から右に伸ばした半直線が、線分[p0,p1)と交差するかどうかを判定
-    // 交差する時、x_cross_pointのポインタが渡されていればそのx座標をx_cross_pointに代入。NULLなら何もしない
-    // 計算量削減のため、p0.yやp1.yがyと一致した場合は、0.005程度p0やp1をシフトする。
-    bool is_crossing( const coordinate_t x, const coordinate_t y, const Point2D &p0, const Point2D &p1, coordinate_t *x_cross_point ) const;
+    // 辺テーブルの作成
+    void build_edge_table() const;
+    // 辺テーブルの領域の解放
+    void release_edge_storage() const;
+    // 凸分割の作成
+    void build_convex_pieces() const;
+    // 辺テーブルと凸分割の破棄。ポリゴンを変更した時に呼ぶ
+    inline void invalidate_caches(){ this->edge_table_is_valid = false; this->convex_pieces_is_valid = false; }
+
+    // 辺eと直線yが交差するかどうかを判定し、交差する時はそのx座標をx_cross_pointに代入。
+    // 頂点での重複を避けるため、y_min < y <= y_maxの時に交差とする。
+    inline bool edge_crossing( const uint16_t e, const coordinate_t y, coordinate_t &x_cross_point ) const{
+        const EdgeTable &t = this->edge_table;
+        if( t.y_min[e] < y && y <= t.y_max[e] ){
+            x_cross_point = ( y == t.y_max[e] ) ? t.x_at_y_max[e] : t.x_at_y_min[e] + ( y - t.y_min[e] ) * t.dxdy[e];
+            return true;
+        }
+        return false;
+    }
 
     //================
     // Public Functions / 関数
@@ -59,6 +140,21 @@ class Polygon2D{
     void add_Point2D( const Point2D p );
     void add_Point2D( const float x, const float y ); // 中で(Point2Dで)internal scale倍
 
+    // Functions to define contours / 輪郭の追加
+    // The points added after begin_contour() form a new contour. 以降の点は新しい輪郭になる
+    void begin_contour();
+    // Add the contours of p as new contours. If inversely is true, the order of the points is reversed.
+    // pの輪郭を新しい輪郭として追加。inverselyがtrueなら点の順序を逆にする(NON_ZEROで穴にする時)
+    void add_contour( const Polygon2D &p, const bool inversely = false );
+    inline uint16_t n_contours() const {return this->contour_starts.size();}
+    // [contour_start(c), contour_end(c)) are the indices of the points of the contour c
+    inline uint16_t contour_start( const uint16_t c ) const {return this->contour_starts[c];}
+    inline uint16_t contour_end( const uint16_t c ) const {return ( c + 1U < this->contour_starts.size() ) ? this->contour_starts[c+1] : this->vertices.size();}
+
+    // Fill rule / 塗りつぶし規則
+    inline void set_fill_rule( const FILL_RULE rule ){this->fill_rule = rule;}
+    inline FILL_RULE get_fill_rule() const {return this->fill_rule;}
+
     // Basic Shapes
     void rectangle( Point2D p0, Point2D p1 );  //
     void line_segment( Point2D p0, Point2D p1, float weight );
@@ -69,9 +165,22 @@ class Polygon2D{
     //Polygon2D frame( float weight );
     
     
+    EdgeTable get_edge_table() const;
+
+    // Convex pieces of the polygon (ear clipping and merging of the triangles).
+    // The pieces do not overlap and their union is the polygon. Collinear points are allowed in a piece.
+    // Empty if the polygon is convex, has several contours, or is not simple (self-intersecting).
+    // Cached until the polygon is modified. For static geometry, call this once: if the polygon is convex
+    // except for collinear points, it becomes one piece and Canvas::fill_polygon uses the fast path for convex polygons.
+    // 凸多角形への分割。重ならず、和が元のポリゴンになる。変更されるまでキャッシュする。
+    // 静的な図形はこれを一度呼んでおく。一直線に並ぶ点を除けば凸なポリゴンは1つのピースになり、凸用の高速な描画を使う。
+    const std::vector<Polygon2D> &get_convex_pieces() const;
+    // true if the convex pieces are cached and not empty (does not build them) / 凸分割がキャッシュされているか
+    inline bool has_convex_pieces() const {return this->convex_pieces_is_valid && !this->convex_pieces.empty();}
+
     // indexの点を返す。
     Point2D get_Point2D(const uint16_t index) const;
-    inline uint16_t size(){return this->vertices.size();} 
+    inline uint16_t size() const {return this->vertices.size();} 
     //
     bool is_convex_polygon() const{return this->is_convex;}
     bool is_the_point_inside(const coordinate_t x, const coordinate_t y, coordinate_t &first_crossing_point_X ) const;
@@ -81,6 +190,9 @@ class Polygon2D{
     static const uint8_t n_divides = COODINATES_RESOLUTION;
     static const uint8_t n_subpixels = n_divides * n_divides;
     void compute_covered_areas(const pixel_index_t iy, const pixel_index_t start_x, const pixel_index_t end_x, uint8_t *areas ) const;
+    // サブサンプルの配置をPatternで指定する版。面積はPattern::coverage_tで返す。
+    template <class Pattern>
+    void compute_covered_areas(const pixel_index_t iy, const pixel_index_t start_x, const pixel_index_t end_x, typename Pattern::coverage_t *areas ) const;
     // バウンディングボックス。余白なし
     void get_bounding_box( pixel_index_t &isx, pixel_index_t &isy, pixel_index_t &iex, pixel_index_t &iey) const;
     void get_sx_mix_and_out( const pixel_index_t iy, pixel_index_t &sx_mix, pixel_index_t &sx_out ) const; // for fill_polygon
@@ -88,7 +200,7 @@ class Polygon2D{
 
     // operators
     public:
-    Polygon2D & operator = (const Polygon2D p);
+    Polygon2D & operator = (const Polygon2D &p);
     Polygon2D & operator += (const Point2D p);
     Polygon2D & operator -= (const Point2D p);
     Polygon2D & operator *= (const float f);
@@ -104,20 +216,61 @@ class Polygon2D{
     Polygon2D & rotate_equal( const float deg, Point2D center ); 
     Polygon2D & rotate_equal( const float cos_theta, const float sin_theta ); 
 
-    void concat( const Polygon2D p );
-    void concat_inversely( const Polygon2D p );
+    // Clip by the rectangle [x0, x1] x [y0, y1] in internal coordinates (Sutherland-Hodgman).
+    // Each contour is clipped separately and the fill rule is kept, so the points inside the rectangle
+    // are inside of the result if and only if they are inside of this polygon.
+    // 矩形[x0, x1] x [y0, y1]で切り取ったポリゴン。矩形内の点の内外判定は元のポリゴンと同じ。
+    Polygon2D clip( const coordinate_t x0, const coordinate_t y0, const coordinate_t x1, const coordinate_t y1 ) const;
+    // The same, into clipped (without a copy of the result). clipped and the work buffers use the arena if it is given.
+    // 結果をclippedに書き込む版。arenaを与えると作業領域とclippedの領域をアリーナから確保する。
+    void clip( const coordinate_t x0, const coordinate_t y0, const coordinate_t x1, const coordinate_t y1, Polygon2D &clipped, FrameArena *arena = NULL ) const;
+
+    void concat( const Polygon2D &p );
+    void concat_inversely( const Polygon2D &p );
     
     void print() const;
 
-
-    private:
-#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
-    static constexpr coordinate_t init_pos = -0.5f + 0.5f / (COODINATES_RESOLUTION);
-    static constexpr coordinate_t delta_pos = 1.0f / (COODINATES_RESOLUTION);
-#else
-    static const coordinate_t init_pos = (-internal_scale + internal_scale / (COODINATES_RESOLUTION))/2;
-    static const coordinate_t delta_pos = internal_scale / (COODINATES_RESOLUTION);
-#endif    
 };
+
+template <class Pattern>
+void Polygon2D::compute_covered_areas(const pixel_index_t iy, const pixel_index_t start_x, const pixel_index_t end_x, typename Pattern::coverage_t *areas ) const{
+
+    // zero clear the areas
+    for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
+        areas[(ix-start_x)] = 0U;        
+    }
+
+
+    for(int j = 0; j < Pattern::n_rows; j++){
+        coordinate_t y = Pattern::y_of_row( iy, j );
+        coordinate_t first_cross_point_X = end_x * internal_scale + 1;
+        bool first_judge = true;
+        bool former_result = false;
+        uint8_t n_samples_in_row = Pattern::n_samples_in_row( j );
+
+        for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
+            for( int i = 0; i < n_samples_in_row; i++){
+                coordinate_t x = Pattern::x_of_sample( ix, j, i );
+                // 交点が左側にある時は調べ直す必要があるので、交点をリセットしてフラグを立てる。
+                if( x > first_cross_point_X ){
+                    first_cross_point_X = end_x * internal_scale + 1;
+                    first_judge = true;
+                }
+                // 最初の交点が調べたい点よりも右側の場合は、判定が変わらずし直す必要がないので、チェック
+                if( x <= first_cross_point_X && first_judge == false ){
+                    // 再判定必要なし。
+                }else{
+                    // 再判定必要あり
+                    former_result = is_the_point_inside(x,y, first_cross_point_X);
+                    first_judge = false;
+                }
+                if( former_result ){
+                    areas[ix-start_x] += Pattern::row_coverage( j, i, i );
+                }
+            }
+        }
+    }
+    return;
+}
 // __POLYGON2D_HPP__
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #include "SSD1331.hpp"
+#include <string.h>
 void SSD1331::init( int pin_DCCntl, int pin_RST, int pin_CS ){
     // pin setting
     this->pin_DCCntl = pin_DCCntl;
@@ -21,7 +22,9 @@ void SSD1331::init( int pin_DCCntl, int pin_RST, int pin_CS ){
     SPI.setBitOrder(MSBFIRST);
     SPI.setDataMode(SPI_MODE3);
 
+    this->frame_arena = NULL;
     set_display_on_off(DISPLAY_POWER::DISPLAY_OFF);
+    this->color_depth = COLOR_DEPTH::COLOR_65K;
     set_remap_color_depth( HORIZONTAL_DIR::LR_NORMAL, VERTICAL_DIR::TB_NORMAL );
     set_display_start_line(0);
     set_display_offset(0);
@@ -67,6 +70,10 @@ void SSD1331::v_flip(){
 void SSD1331::rotate(){
     set_remap_color_depth( HORIZONTAL_DIR::LR_FLIP, VERTICAL_DIR::TB_FLIP );    
 }
+void SSD1331::set_color_depth( COLOR_DEPTH depth ){
+    this->color_depth = depth;
+    set_remap_color_depth( this->h_dir, this->v_dir );
+}
 
 void SSD1331::send_frame_65K(unsigned char *p_data){
     set_colmun_address( 0, max_w );
@@ -75,69 +82,59 @@ void SSD1331::send_frame_65K(unsigned char *p_data){
 }
 
 void SSD1331::send_frame(unsigned char *p_data){
-    Serial.println("1byte");
-    set_colmun_address( 0, width );
+    set_colmun_address( 0, max_w );
     set_row_address( 0, max_h );
     send_data( p_data, 6144 ); // 96 x 64
 }
 
+// 行単位のデータ送信 for 65536色
+void SSD1331::send_rows_65K( unsigned char *p_data, const char start_y, const char end_y ){
+    set_colmun_address( 0, max_w );
+    set_row_address( start_y, end_y );
+    send_data( p_data, 2 * width * ( end_y - start_y + 1 ) );
+}
+
 // 部分データ送信 for 65536色
+// The rows are copied into a buffer in the arena and sent at once. Without the arena (or if it is full),
+// they are sent row by row. / アリーナに詰めて一度に送る。確保できなければ1行ずつ送る。
 void SSD1331::send_partial_data_65K( unsigned char *p_data, const char start_x, const char start_y, const char end_x, const char end_y ){
-    // 
-    try{
-        // first copy data to buffer then send it 
-        unsigned int size = 2 * ( end_x - start_x + 1 ) * ( end_y - start_y + 1 );
-        unsigned char* buffer = new unsigned char[ size ];
-        unsigned char* p_buf = buffer;
-        // data 
-        for( char y = start_y; y <= end_y; y++ ){
-            unsigned char* p_dat = &(p_data[ ( y * width + start_x ) * 2 ]);            
-            for( char n = 0; n < size; n++ ){
-                *p_buf = *p_dat;
-                p_dat++;
-                p_buf++;
-            }
+    const int row_bytes = 2 * ( end_x - start_x + 1 );
+    const int n_rows = end_y - start_y + 1;
+    set_colmun_address( start_x, end_x );
+    set_row_address( start_y, end_y );
+    unsigned char *buffer = ( this->frame_arena != NULL ) ? this->frame_arena->allocate_array<unsigned char>( row_bytes * n_rows ) : NULL;
+    if( buffer != NULL ){
+        unsigned char *p_buf = buffer;
+        for( int y = start_y; y <= end_y; y++ ){
+            memcpy( p_buf, &p_data[ ( y * width + start_x ) * 2 ], row_bytes );
+            p_buf += row_bytes;
         }
-        set_colmun_address( start_x, end_x );
-        set_row_address( start_y, end_y );
-        send_data( buffer, 2 * size );
-        delete [] buffer; 
-    }catch(std::bad_alloc){
-        set_colmun_address( start_x, end_x );
-        set_row_address( start_y, end_y );
+        send_data( buffer, row_bytes * n_rows );
+    }else{
         // send line by line
-        int size_in_bytes = 2 * ( end_x - start_x + 1 );
-        for( char y = start_y; y <= end_y; y++ ){
-            unsigned char *p = p_data + (y * width + start_x)*2;
-            send_data( p, size_in_bytes );
+        for( int y = start_y; y <= end_y; y++ ){
+            send_data( &p_data[ ( y * width + start_x ) * 2 ], row_bytes );
         }
     }
 }
 // 部分データ送信 for 256色
 void SSD1331::send_partial_data( unsigned char *p_data, const char start_x, const char start_y, const char end_x, const char end_y ){
-    try{
-        // first copy data to buffer then send it 
-        unsigned int size = ( end_x - start_x + 1 ) * ( end_y - start_y + 1 );
-        unsigned char *buffer = new unsigned char[ size ];
-        unsigned char *p = buffer;
-        for( char y = start_y; y <= end_y; y++ ){
-            for( char x = start_x; x <= end_x; x++ ){
-                *p = p_data[ y * width + x ];
-                p++;
-            }
+    const int row_bytes = end_x - start_x + 1;
+    const int n_rows = end_y - start_y + 1;
+    set_colmun_address( start_x, end_x );
+    set_row_address( start_y, end_y );
+    unsigned char *buffer = ( this->frame_arena != NULL ) ? this->frame_arena->allocate_array<unsigned char>( row_bytes * n_rows ) : NULL;
+    if( buffer != NULL ){
+        unsigned char *p_buf = buffer;
+        for( int y = start_y; y <= end_y; y++ ){
+            memcpy( p_buf, &p_data[ y * width + start_x ], row_bytes );
+            p_buf += row_bytes;
         }
-        set_colmun_address( start_x, end_x );
-        set_row_address( start_y, end_y );
-        send_data( buffer, size );
-        delete [] buffer; 
-    }catch(std::bad_alloc){
-        set_colmun_address( start_x, end_x );
-        set_row_address( start_y, end_y );
+        send_data( buffer, row_bytes * n_rows );
+    }else{
         // send line by line
-        int size_in_bytes = ( end_x - start_x + 1 );
-        for( char y = start_y; y <= end_y; y++ ){
-            unsigned char *p = p_data + y * width + start_x;
-            send_data( p, size_in_bytes );
+        for( int y = start_y; y <= end_y; y++ ){
+            send_data( &p_data[ y * width + start_x ], row_bytes );
         }
     }
 }
@@ -210,8 +207,10 @@ void SSD1331::set_remap_color_depth(
 ){
     unsigned char direction = 0; 
     unsigned char color_order = 0; 
+    this->h_dir = h_dir;
+    this->v_dir = v_dir;
 
-    unsigned char signal = direction + (h_dir << 1) + (color_order << 2 ) + (v_dir << 4) + (1<<5)+ (1<<6);
+    unsigned char signal = direction + (h_dir << 1) + (color_order << 2 ) + (v_dir << 4) + (1<<5)+ (static_cast<unsigned char>(this->color_depth)<<6);
     send_command( 0xa0 );
     send_command( signal );
 
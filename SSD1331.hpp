@@ -11,6 +11,7 @@
 //#define __DRAW_COMMANDS_ENABLE__ // NOT IMPLEMENTED
 
 #include "SPI.h" // Arduino environment
+#include "FrameArena.hpp"
 
 class SSD1331{
 
@@ -25,6 +26,7 @@ class SSD1331{
     int pin_DCCntl; // data or command
     int pin_RST;    // reset
     int pin_CS;     // chip select
+    FrameArena *frame_arena; // buffers of the partial transfers (NULL: sent row by row)
 
     public:
     // initialize pin setting, display settings
@@ -49,14 +51,28 @@ class SSD1331{
     // 垂直方向反転状態に設定
     void v_flip();
 
+    // 色数 (the bits 7:6 of the remap command) 
+    enum class COLOR_DEPTH : unsigned char{
+        COLOR_256 = 0, // 1 byte per pixel, RRRGGGBB
+        COLOR_65K = 1  // 2 bytes per pixel, RRRRRGGG GGGBBBBB
+    };
+    // 色数の切り替え。画面の向きは変わらない。
+    void set_color_depth( COLOR_DEPTH depth );
+    COLOR_DEPTH get_color_depth() const { return this->color_depth; }
+
     // フルフレームデータ送信 for 65536色モード
     void send_frame_65K(unsigned char *p_data); // send full frame (96x64x2bytes)
     // フルフレームデータ送信 for 256色モード
     void send_frame(unsigned char *p_data);  // send full frame (96x64x1bytes)
+    // 部分転送の一時バッファの領域(initの後に設定)。リセットは呼び出し側がフレームごとに行う。
+    // The area is sent row by row without the arena or when the arena is full.
+    void set_frame_arena( FrameArena *arena ){ this->frame_arena = arena; }
     // 部分データ送信 for 65536色
     void send_partial_data_65K( unsigned char *p_data, const char start_x, const char start_y, const char end_x, const char end_y );
     // 部分データ送信 for 256色
     void send_partial_data( unsigned char *p_data, const char start_x, const char start_y, const char end_x, const char end_y );
+    // 行単位のデータ送信 for 65536色 (rows start_y to end_y, 96x2 bytes each, e.g. converted from an indexed canvas)
+    void send_rows_65K( unsigned char *p_data, const char start_y, const char end_y );
 
 
     private:
@@ -75,6 +91,10 @@ class SSD1331{
         LR_NORMAL = 1,
         LR_FLIP = 0
     };
+    // the current remap settings, kept when one of them is changed / 現在のremap設定
+    HORIZONTAL_DIR h_dir;
+    VERTICAL_DIR v_dir;
+    COLOR_DEPTH color_depth;
     void set_remap_color_depth( 
         HORIZONTAL_DIR h_dir = HORIZONTAL_DIR::LR_NORMAL,
         VERTICAL_DIR v_dir = VERTICAL_DIR::TB_NORMAL
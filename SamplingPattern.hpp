@@ -0,0 +1,116 @@
+#ifndef __SAMPLING_PATTERN_HPP__
+#define __SAMPLING_PATTERN_HPP__
+/*==============================================================//
+Sampling patterns / サブサンプルの配置
+    Policies that define the subsample positions used to estimate the
+    covered area of a pixel. Canvas, Polygon2D and ActiveEdgeTable take
+    one of them as a template parameter.
+
+    The subsamples are arranged in rows. The samples of a row are sorted
+    by x, so that the samples of a pixel inside a span (a, b] of a row are
+    a contiguous range [first, last].
+    row_coverage( j, first, last ) returns the value added to the coverage
+    of the pixel for the range. The ranges of a pixel never overlap, so
+    the values are simply added.
+      - counted patterns: the coverage is the number of samples
+      - masked patterns (16 samples or less): the coverage is a bitmask of
+        the samples, and the number of samples is its popcount
+
+    Interface:
+      typedef coverage_t                    : per pixel coverage
+      n_rows, n_samples                     : n_samples is the full coverage
+      n_samples_in_row( j )
+      y_of_row( iy, j )                     : y of the row j of the pixel row iy
+      x_of_sample( ix, j, i )               : x of the i-th sample of the row j
+      row_coverage( j, first, last )
+      row_full_coverage( j )                : all samples of the row j
+      count( c )                            : number of samples in c
+//==============================================================*/
+#include "resolution.hpp"
+#include <type_traits>
+
+// N x N grid. N = COODINATES_RESOLUTION is the default pattern.
+// 4x4 or less is stored as a bitmask.
+template <uint8_t N>
+class GridPattern{
+    public:
+    static const bool is_masked = ( N * N <= 16 );
+    typedef typename std::conditional< is_masked, uint16_t,
+        typename std::conditional< ( N * N <= 255 ), uint8_t, uint16_t >::type >::type coverage_t;
+    static const uint8_t n_rows = N;
+    static const uint16_t n_samples = N * N;
+
+    static inline uint8_t n_samples_in_row( const uint8_t ){ return N; }
+    static inline coordinate_t y_of_row( const pixel_index_t iy, const uint8_t j ){
+        return iy * internal_scale + init_pos + delta_pos * j;
+    }
+    static inline coordinate_t x_of_sample( const pixel_index_t ix, const uint8_t, const uint8_t i ){
+        return ix * internal_scale + init_pos + delta_pos * i;
+    }
+    static inline coverage_t row_coverage( const uint8_t j, const uint8_t first, const uint8_t last ){
+        return is_masked ? static_cast<coverage_t>( ( ( 2U << last ) - ( 1U << first ) ) << ( j * N ) ) : last - first + 1;
+    }
+    static inline coverage_t row_full_coverage( const uint8_t j ){
+        return row_coverage( j, 0, N - 1 );
+    }
+    static inline uint16_t count( const coverage_t c ){
+        return is_masked ? __builtin_popcount( c ) : c;
+    }
+
+    private:
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    static constexpr coordinate_t init_pos = -0.5f + 0.5f / N;
+    static constexpr coordinate_t delta_pos = 1.0f / N;
+#else
+    static const coordinate_t init_pos = (-internal_scale + internal_scale / N)/2;
+    static const coordinate_t delta_pos = internal_scale / N;
+#endif
+};
+
+// N-rooks pattern: one sample per row and per column.
+// The sample of the row k is in the column (k * STRIDE) % N, STRIDE must be coprime to N.
+// With a stride close to sqrt(N) the samples form a rotated grid.
+// N <= 16, stored as a bitmask (bit k is the sample of the row k).
+template <uint8_t N, uint8_t STRIDE>
+class RooksPattern{
+    static_assert( N <= 16, "RooksPattern supports 16 samples at most." );
+    public:
+    static const bool is_masked = true;
+    typedef uint16_t coverage_t;
+    static const uint8_t n_rows = N;
+    static const uint16_t n_samples = N;
+
+    static inline uint8_t n_samples_in_row( const uint8_t ){ return 1; }
+    static inline coordinate_t y_of_row( const pixel_index_t iy, const uint8_t j ){
+        return iy * internal_scale + init_pos + delta_pos * j;
+    }
+    static inline coordinate_t x_of_sample( const pixel_index_t ix, const uint8_t j, const uint8_t ){
+        return ix * internal_scale + init_pos + delta_pos * ( ( j * STRIDE ) % N );
+    }
+    static inline coverage_t row_coverage( const uint8_t j, const uint8_t, const uint8_t ){
+        return static_cast<coverage_t>( 1U << j );
+    }
+    static inline coverage_t row_full_coverage( const uint8_t j ){
+        return static_cast<coverage_t>( 1U << j );
+    }
+    static inline uint16_t count( const coverage_t c ){
+        return __builtin_popcount( c );
+    }
+
+    private:
+#ifdef USE_SINGLE_PRECISION_FLOATING_COORDINATES
+    static constexpr coordinate_t init_pos = -0.5f + 0.5f / N;
+    static constexpr coordinate_t delta_pos = 1.0f / N;
+#else
+    static const coordinate_t init_pos = (-internal_scale + internal_scale / N)/2;
+    static const coordinate_t delta_pos = internal_scale / N;
+#endif
+};
+
+// Frequently used patterns
+typedef GridPattern<COODINATES_RESOLUTION> DefaultSamplingPattern; // 5x5
+typedef GridPattern<4> Grid4x4Pattern;      // 16 samples, bitmask
+typedef RooksPattern<8, 3> Rooks8Pattern;   // 8 samples, about 1/3 of 5x5
+typedef RooksPattern<16, 5> Rooks16Pattern; // 16 samples, rotated grid
+
+#endif
@@ -0,0 +1,149 @@
+#include "SignedAreaRasterizer.hpp"
+#include <cmath>
+#include <algorithm>
+
+// 辺テーブルから辺を登録して上端でソートする。
+SignedAreaRasterizer::SignedAreaRasterizer( const Polygon2D &polygon, FrameArena *arena ){
+    this->edges.set_arena( arena );
+    this->active_edges.set_arena( arena );
+    this->acc.set_arena( arena );
+    Polygon2D::EdgeTable table = polygon.get_edge_table();
+    this->fill_rule = polygon.get_fill_rule();
+    this->edges.resize( table.n_edges );
+    for( uint16_t n = 0; n < table.n_edges; n++ ){
+        // 画素ixが[ix, ix+1)となるように0.5ずらす
+        Edge &e = this->edges[n];
+        e.x_top = static_cast<float>( table.x_at_y_min[n] ) / internal_scale + 0.5f;
+        e.y_top = static_cast<float>( table.y_min[n] ) / internal_scale + 0.5f;
+        e.y_bottom = static_cast<float>( table.y_max[n] ) / internal_scale + 0.5f;
+        e.dxdy = table.dxdy[n];
+        e.dir = table.dir[n];
+    }
+    std::sort( this->edges.begin(), this->edges.end(), []( const Edge &a, const Edge &b ){ return a.y_top < b.y_top; } );
+    this->next_edge = 0;
+    this->active_edges.reserve( this->edges.size() );
+
+    pixel_index_t isx, isy, iex, iey;
+    polygon.get_bounding_box( isx, isy, iex, iey );
+    this->x_origin = isx - 1;
+    this->acc.assign( iex - isx + 4, 0.0f );
+    this->min_cell = this->acc.size();
+    this->max_cell = -1;
+}
+
+bool SignedAreaRasterizer::scan_row( const pixel_index_t iy ){
+    // 前の行の累積値をクリア
+    for( int c = this->min_cell; c <= this->max_cell; c++ ){
+        this->acc[c] = 0.0f;
+    }
+    this->min_cell = this->acc.size();
+    this->max_cell = -1;
+
+    float row_top = iy;
+    float row_bottom = iy + 1;
+    uint16_t n_edges = this->edges.size();
+    // 上端が行に入った辺を追加
+    while( this->next_edge < n_edges && this->edges[this->next_edge].y_top < row_bottom ){
+        this->active_edges.push_back( this->next_edge );
+        this->next_edge++;
+    }
+    for( uint16_t a = 0; a < this->active_edges.size(); ){
+        const Edge &e = this->edges[this->active_edges[a]];
+        // 下端が行より上にある辺を削除
+        if( e.y_bottom <= row_top ){
+            this->active_edges[a] = this->active_edges.back();
+            this->active_edges.pop_back();
+            continue;
+        }
+        float ya = std::max( e.y_top, row_top );
+        float yb = std::min( e.y_bottom, row_bottom );
+        if( ya < yb ){
+            accumulate( e, ya, yb );
+        }
+        a++;
+    }
+    return this->min_cell <= this->max_cell;
+}
+
+// 行内の辺[ya, yb)が通過するセルに、辺の右側の面積を符号付きで加算する。
+// 右側のセルには残りの高さ(d)を加算し、累積した時に内側が d になるようにする。
+void SignedAreaRasterizer::accumulate( const Edge &e, const float ya, const float yb ){
+    float x = e.x_top + ( ya - e.y_top ) * e.dxdy;
+    float dy = yb - ya;
+    float xnext = x + e.dxdy * dy;
+    float d = dy * e.dir;
+    float x0 = std::min( x, xnext );
+    float x1 = std::max( x, xnext );
+    float x0floor = floor( x0 );
+    float x1ceil = ceil( x1 );
+    int x0i = static_cast<int>( x0floor ) - this->x_origin;
+    int x1i = static_cast<int>( x1ceil ) - this->x_origin;
+    if( x1i <= x0i + 1 ){
+        // 1つのセルの中
+        float xmf = 0.5f * ( x + xnext ) - x0floor;
+        add( x0i, d - d * xmf );
+        add( x0i + 1, d * xmf );
+    }else{
+        // 複数のセルにまたがる
+        float s = 1.0f / ( x1 - x0 );
+        float x0f = x0 - x0floor;
+        float a0 = 0.5f * s * ( 1.0f - x0f ) * ( 1.0f - x0f );
+        float x1f = x1 - x1ceil + 1.0f;
+        float am = 0.5f * s * x1f * x1f;
+        add( x0i, d * a0 );
+        if( x1i == x0i + 2 ){
+            add( x0i + 1, d * ( 1.0f - a0 - am ) );
+        }else{
+            float a1 = s * ( 1.5f - x0f );
+            add( x0i + 1, d * ( a1 - a0 ) );
+            for( int xi = x0i + 2; xi < x1i - 1; xi++ ){
+                add( xi, d * s );
+            }
+            float a2 = a1 + ( x1i - x0i - 3 ) * s;
+            add( x1i - 1, d * ( 1.0f - a2 - am ) );
+        }
+        add( x1i, d * am );
+    }
+}
+
+inline void SignedAreaRasterizer::add( int cell, const float val ){
+    if( cell < 0 ) cell = 0;
+    if( cell >= static_cast<int>(this->acc.size()) ) cell = this->acc.size() - 1;
+    this->acc[cell] += val;
+    if( this->min_cell > cell ) this->min_cell = cell;
+    if( this->max_cell < cell ) this->max_cell = cell;
+}
+
+void SignedAreaRasterizer::get_sx_mix_and_out( pixel_index_t &sx_mix, pixel_index_t &sx_out ) const{
+    sx_mix = this->x_origin + this->min_cell;
+    sx_out = this->x_origin + this->max_cell;
+}
+
+void SignedAreaRasterizer::compute_covered_areas( const pixel_index_t start_x, const pixel_index_t end_x, uint8_t *areas ) const{
+    // start_xより左のセルを累積
+    float sum = 0.0f;
+    int cell = this->min_cell;
+    for( ; cell < start_x - this->x_origin && cell <= this->max_cell; cell++ ){
+        sum += this->acc[cell];
+    }
+    for( pixel_index_t ix = start_x; ix <= end_x; ix++ ){
+        cell = ix - this->x_origin;
+        if( this->min_cell <= cell && cell <= this->max_cell ){
+            sum += this->acc[cell];
+        }
+        areas[ix-start_x] = to_area( sum );
+    }
+}
+
+// 偶奇規則: 累積値の絶対値を2で折り返す
+// 非ゼロ規則: 累積値の絶対値を1で飽和させる
+uint8_t SignedAreaRasterizer::to_area( const float sum ) const{
+    float c = fabs( sum );
+    if( this->fill_rule == Polygon2D::NON_ZERO ){
+        if( c > 1.0f ) c = 1.0f;
+    }else{
+        c = c - 2.0f * floor( c * 0.5f );
+        if( c > 1.0f ) c = 2.0f - c;
+    }
+    return static_cast<uint8_t>( c * area_full + 0.5f );
+}
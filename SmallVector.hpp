@@ -0,0 +1,172 @@
+#ifndef __SMALL_VECTOR_HPP__
+#define __SMALL_VECTOR_HPP__
+/*==============================================================//
+class SmallVector
+    A vector with the storage of N elements in itself. Nothing is
+    allocated while the size is N or less, so the small polygons and the
+    rasterizers of them do not use the heap on the drawing path.
+    Beyond N, the elements move to the heap like std::vector.
+    N要素分の領域を内部に持つvector。N要素以下ならヒープを使わない。
+
+    Only the functions of std::vector used in this library.
+    The heap storage is kept until the destruction (clear() keeps it),
+    so a reused vector does not allocate again.
+    clear()は領域を解放しないので、再利用すれば再確保しない。
+
+    With set_arena(), the storage beyond N is taken from a FrameArena
+    (the heap is used only when the arena is full). Such a vector is a
+    temporary of the frame, and must not be used after the arena is reset.
+    set_arena()でN要素を超えた分をFrameArenaから確保する(フレーム内の一時データ用)。
+//==============================================================*/
+#include <stddef.h>
+#include <new>
+#include "FrameArena.hpp"
+
+template <class T, unsigned int N>
+class SmallVector{
+    static_assert( N > 0, "N must be positive" );
+
+    //================
+    // variables
+    //================
+    public:
+    typedef T value_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+    private:
+    T *p;
+    unsigned int n;
+    unsigned int n_capacity;
+    FrameArena *arena;  // NULL: the heap is used / NULLならヒープ
+    bool is_in_arena;   // p points to the memory of the arena / pがアリーナの領域
+    alignas( T ) unsigned char buffer[ N * sizeof( T ) ];
+
+    //================
+    // constructor / コンストラクタ
+    //================
+    public:
+    SmallVector() : p( inline_data() ), n( 0 ), n_capacity( N ), arena( NULL ), is_in_arena( false ){}
+    explicit SmallVector( const unsigned int size, const T &value = T() ) : p( inline_data() ), n( 0 ), n_capacity( N ), arena( NULL ), is_in_arena( false ){
+        assign( size, value );
+    }
+    // The arena is not copied / アリーナはコピーしない
+    SmallVector( const SmallVector &src ) : p( inline_data() ), n( 0 ), n_capacity( N ), arena( NULL ), is_in_arena( false ){
+        assign( src.begin(), src.end() );
+    }
+    ~SmallVector(){
+        clear();
+        release();
+    }
+    SmallVector &operator = ( const SmallVector &src ){
+        if( this != &src ){
+            assign( src.begin(), src.end() );
+        }
+        return *this;
+    }
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    inline unsigned int size() const { return this->n; }
+    inline bool empty() const { return this->n == 0; }
+    inline unsigned int capacity() const { return this->n_capacity; }
+    // true while the elements are in the object / 要素が内部の領域にあるか
+    inline bool is_inline() const { return this->p == inline_data(); }
+    // Take the storage beyond N from the arena from the next growth / 以降の拡張はアリーナから確保
+    inline void set_arena( FrameArena *arena ){ this->arena = arena; }
+
+    inline T &operator [] ( const unsigned int i ){ return this->p[i]; }
+    inline const T &operator [] ( const unsigned int i ) const { return this->p[i]; }
+    inline T *data(){ return this->p; }
+    inline const T *data() const { return this->p; }
+    inline iterator begin(){ return this->p; }
+    inline iterator end(){ return this->p + this->n; }
+    inline const_iterator begin() const { return this->p; }
+    inline const_iterator end() const { return this->p + this->n; }
+    inline T &back(){ return this->p[ this->n - 1 ]; }
+    inline const T &back() const { return this->p[ this->n - 1 ]; }
+
+    inline void push_back( const T &value ){
+        if( this->n == this->n_capacity ){
+            T v( value ); // value may be an element of this / valueが自身の要素の場合
+            reserve( 2 * this->n_capacity );
+            new( this->p + this->n ) T( v );
+        }else{
+            new( this->p + this->n ) T( value );
+        }
+        this->n++;
+    }
+    inline void pop_back(){
+        this->n--;
+        this->p[ this->n ].~T();
+    }
+    // Remove all elements. The storage is kept. / 全要素を削除(領域は保持)
+    inline void clear(){
+        for( unsigned int i = 0; i < this->n; i++ ){
+            this->p[i].~T();
+        }
+        this->n = 0;
+    }
+    inline void reserve( const unsigned int m ){
+        if( m > this->n_capacity ){
+            grow( m );
+        }
+    }
+    void resize( const unsigned int m, const T &value = T() ){
+        while( this->n > m ){
+            pop_back();
+        }
+        reserve( m );
+        for( ; this->n < m; this->n++ ){
+            new( this->p + this->n ) T( value );
+        }
+    }
+    void assign( const unsigned int m, const T &value ){
+        clear();
+        resize( m, value );
+    }
+    // [first, last) must not be in this vector / 自身の要素は渡さない
+    template <class Iterator>
+    void assign( Iterator first, const Iterator last ){
+        clear();
+        reserve( last - first );
+        for( ; first != last; ++first ){
+            new( this->p + this->n ) T( *first );
+            this->n++;
+        }
+    }
+
+    private:
+    // move the elements to the storage of m elements (out of line, the growth is rare) / 領域の拡張
+    void grow( const unsigned int m ){
+        T *q = NULL;
+        if( this->arena != NULL ){
+            q = this->arena->allocate_array<T>( m );
+        }
+        const bool q_is_in_arena = ( q != NULL );
+        if( q == NULL ){
+            q = static_cast<T*>( ::operator new( m * sizeof( T ) ) );
+        }
+        for( unsigned int i = 0; i < this->n; i++ ){
+            new( q + i ) T( this->p[i] );
+            this->p[i].~T();
+        }
+        release();
+        this->p = q;
+        this->n_capacity = m;
+        this->is_in_arena = q_is_in_arena;
+    }
+    inline T *inline_data(){ return reinterpret_cast<T*>( this->buffer ); }
+    inline const T *inline_data() const { return reinterpret_cast<const T*>( this->buffer ); }
+    inline void release(){
+        if( !is_inline() && !this->is_in_arena ){
+            ::operator delete( this->p );
+        }
+        this->p = inline_data();
+        this->is_in_arena = false;
+        this->n_capacity = N;
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+// The scalar and SIMD versions must round in the same way, so a * b + c is not fused.
+// 結果を一致させるため、積和を融合しない
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+#include "SubsampleKernels.hpp"
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+SubsampleKernels::ISA SubsampleKernels::isa = SubsampleKernels::detect_isa();
+SubsampleKernels::EdgeCrossingsKernel SubsampleKernels::kernel = SubsampleKernels::get_kernel( SubsampleKernels::detect_isa() );
+
+SubsampleKernels::ISA SubsampleKernels::detect_isa(){
+#if defined(__x86_64__) || defined(__SSE2__)
+#if defined(__GNUC__)
+    // called from the static initializer / 静的初期化から呼ばれるため
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx2" ) ){
+        return AVX2;
+    }
+#endif
+    return SSE2;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    return NEON;
+#else
+    return SCALAR;
+#endif
+}
+
+SubsampleKernels::EdgeCrossingsKernel SubsampleKernels::get_kernel( const ISA isa ){
+    switch( isa ){
+#if defined(__x86_64__) || defined(__SSE2__)
+        case SSE2: return edge_crossings_sse2;
+        case AVX2: return edge_crossings_avx2;
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+        case NEON: return edge_crossings_neon;
+#endif
+        default: return edge_crossings_scalar;
+    }
+}
+
+bool SubsampleKernels::set_isa( const ISA isa ){
+    EdgeCrossingsKernel k = get_kernel( isa );
+    if( isa != SCALAR && k == edge_crossings_scalar ){
+        return false;
+    }
+#if defined(__x86_64__) || defined(__SSE2__)
+    if( isa == AVX2 && detect_isa() != AVX2 ){
+        return false;
+    }
+#endif
+    SubsampleKernels::isa = isa;
+    SubsampleKernels::kernel = k;
+    return true;
+}
+
+const char *SubsampleKernels::get_isa_name( const ISA isa ){
+    switch( isa ){
+        case SSE2: return "SSE2";
+        case AVX2: return "AVX2";
+        case NEON: return "NEON";
+        default: return "SCALAR";
+    }
+}
+
+uint32_t SubsampleKernels::edge_crossings_scalar( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs ){
+    uint32_t valid = 0;
+    for( uint8_t j = 0; j < n; j++ ){
+        xs[j] = ( ys[j] == y_max ) ? x_at_y_max : x_at_y_min + ( ys[j] - y_min ) * dxdy;
+        if( y_min < ys[j] && ys[j] <= y_max ){
+            valid |= 1U << j;
+        }
+    }
+    return valid;
+}
+
+#if defined(__x86_64__) || defined(__SSE2__)
+uint32_t SubsampleKernels::edge_crossings_sse2( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs ){
+    const __m128 v_y_min = _mm_set1_ps( y_min );
+    const __m128 v_y_max = _mm_set1_ps( y_max );
+    const __m128 v_x0 = _mm_set1_ps( x_at_y_min );
+    const __m128 v_x1 = _mm_set1_ps( x_at_y_max );
+    const __m128 v_dxdy = _mm_set1_ps( dxdy );
+    uint32_t valid = 0;
+    for( uint8_t j = 0; j < n; j += 4 ){
+        __m128 y = _mm_loadu_ps( ys + j );
+        __m128 x = _mm_add_ps( v_x0, _mm_mul_ps( _mm_sub_ps( y, v_y_min ), v_dxdy ) );
+        __m128 at_max = _mm_cmpeq_ps( y, v_y_max );
+        _mm_storeu_ps( xs + j, _mm_or_ps( _mm_and_ps( at_max, v_x1 ), _mm_andnot_ps( at_max, x ) ) );
+        __m128 in = _mm_and_ps( _mm_cmplt_ps( v_y_min, y ), _mm_cmple_ps( y, v_y_max ) );
+        valid |= static_cast<uint32_t>( _mm_movemask_ps( in ) ) << j;
+    }
+    return ( n >= 32 ) ? valid : valid & ( ( 1U << n ) - 1 );
+}
+
+__attribute__((target("avx2")))
+uint32_t SubsampleKernels::edge_crossings_avx2( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs ){
+    const __m256 v_y_min = _mm256_set1_ps( y_min );
+    const __m256 v_y_max = _mm256_set1_ps( y_max );
+    const __m256 v_x0 = _mm256_set1_ps( x_at_y_min );
+    const __m256 v_x1 = _mm256_set1_ps( x_at_y_max );
+    const __m256 v_dxdy = _mm256_set1_ps( dxdy );
+    uint32_t valid = 0;
+    for( uint8_t j = 0; j < n; j += 8 ){
+        __m256 y = _mm256_loadu_ps( ys + j );
+        __m256 x = _mm256_add_ps( v_x0, _mm256_mul_ps( _mm256_sub_ps( y, v_y_min ), v_dxdy ) );
+        _mm256_storeu_ps( xs + j, _mm256_blendv_ps( x, v_x1, _mm256_cmp_ps( y, v_y_max, _CMP_EQ_OQ ) ) );
+        __m256 in = _mm256_and_ps( _mm256_cmp_ps( v_y_min, y, _CMP_LT_OQ ), _mm256_cmp_ps( y, v_y_max, _CMP_LE_OQ ) );
+        valid |= static_cast<uint32_t>( _mm256_movemask_ps( in ) ) << j;
+    }
+    return ( n >= 32 ) ? valid : valid & ( ( 1U << n ) - 1 );
+}
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+uint32_t SubsampleKernels::edge_crossings_neon( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs ){
+    const float32x4_t v_y_min = vdupq_n_f32( y_min );
+    const float32x4_t v_y_max = vdupq_n_f32( y_max );
+    const float32x4_t v_x0 = vdupq_n_f32( x_at_y_min );
+    const float32x4_t v_x1 = vdupq_n_f32( x_at_y_max );
+    const float32x4_t v_dxdy = vdupq_n_f32( dxdy );
+    // lane k -> bit k
+    const uint32_t lane_bits_array[4] = { 1, 2, 4, 8 };
+    const uint32x4_t lane_bits = vld1q_u32( lane_bits_array );
+    uint32_t valid = 0;
+    for( uint8_t j = 0; j < n; j += 4 ){
+        float32x4_t y = vld1q_f32( ys + j );
+        float32x4_t x = vaddq_f32( v_x0, vmulq_f32( vsubq_f32( y, v_y_min ), v_dxdy ) );
+        vst1q_f32( xs + j, vbslq_f32( vceqq_f32( y, v_y_max ), v_x1, x ) );
+        uint32x4_t in = vandq_u32( vcltq_f32( v_y_min, y ), vcleq_f32( y, v_y_max ) );
+        valid |= vaddvq_u32( vandq_u32( in, lane_bits ) ) << j;
+    }
+    return ( n >= 32 ) ? valid : valid & ( ( 1U << n ) - 1 );
+}
+#endif
+
+// ランダムな辺とサンプル行で、全実装の結果をスカラー版と比較する。
+bool SubsampleKernels::self_test(){
+    const ISA isas[] = { SSE2, AVX2, NEON };
+    float ys[32];
+    float xs_ref[32];
+    float xs[32];
+    bool ok = true;
+    unsigned int seed = 1;
+    for( int t = 0; t < 1000 && ok; t++ ){
+        uint8_t n = 1 + t % 16;
+        float y0 = static_cast<float>( rand_r( &seed ) % 2000 ) / 16.0f - 20.0f;
+        for( uint8_t j = 0; j < 32; j++ ){
+            ys[j] = y0 + j * 0.2f;
+        }
+        float y_min = y0 + static_cast<float>( rand_r( &seed ) % 100 ) / 25.0f - 1.0f;
+        float y_max = y_min + static_cast<float>( rand_r( &seed ) % 100 ) / 25.0f;
+        // 境界上のサンプルも調べる
+        if( t % 4 == 0 ) y_min = ys[ t % n ];
+        if( t % 4 == 1 ) y_max = ys[ t % n ];
+        float x0 = static_cast<float>( rand_r( &seed ) % 10000 ) / 77.0f;
+        float dxdy = static_cast<float>( static_cast<int>( rand_r( &seed ) % 2001 ) - 1000 ) / 93.0f;
+        float x1 = static_cast<float>( rand_r( &seed ) % 10000 ) / 77.0f;
+        uint32_t valid_ref = edge_crossings_scalar( y_min, y_max, x0, x1, dxdy, ys, n, xs_ref );
+        for( uint8_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++ ){
+            EdgeCrossingsKernel k = get_kernel( isas[i] );
+            if( k == edge_crossings_scalar ){
+                continue;
+            }
+#if defined(__x86_64__) || defined(__SSE2__)
+            if( isas[i] == AVX2 && detect_isa() != AVX2 ){
+                continue;
+            }
+#endif
+            uint32_t valid = k( y_min, y_max, x0, x1, dxdy, ys, n, xs );
+            if( valid != valid_ref ){
+                ok = false;
+            }
+            for( uint8_t j = 0; j < n; j++ ){
+                if( ( valid_ref >> j & 1U ) && xs[j] != xs_ref[j] ){
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,75 @@
+#ifndef __SUBSAMPLE_KERNELS_HPP__
+#define __SUBSAMPLE_KERNELS_HPP__
+/*==============================================================//
+class SubsampleKernels
+    Kernels that evaluate one edge of the edge table against several
+    subsample rows at once. / 1つの辺を複数のサブサンプル行でまとめて評価する
+    For each row y[j], the edge crosses the row when y_min < y[j] <= y_max
+    (the same rule as Polygon2D), and the crossing point is
+    x_at_y_min + ( y[j] - y_min ) * dxdy, or x_at_y_max if y[j] == y_max.
+
+    Implementations:
+      SCALAR : one row at a time (ESP32 and others)
+      SSE2   : 4 rows (x86-64)
+      AVX2   : 8 rows (x86-64, selected at runtime if the CPU supports it)
+      NEON   : 4 rows (ARM64)
+    The results of all implementations are the same bit by bit.
+    self_test() checks it against the scalar implementation.
+    test/simd_kernels_test.cpp runs it on the host.
+
+    ESP32などではスカラー版を使う。x86-64ではAVX2の有無を実行時に判定する。
+//==============================================================*/
+#include "resolution.hpp"
+#include <stdint.h>
+
+class SubsampleKernels{
+
+    //================
+    // data
+    //================
+    public:
+    enum ISA{
+        SCALAR,
+        SSE2,
+        AVX2,
+        NEON
+    };
+    // ys and xs must have room for n rounded up to max_lanes / ys, xsはmax_lanesの倍数に切り上げた大きさが必要
+    static const uint8_t max_lanes = 8;
+    // the crossing points of the rows are written in xs, and bit j of the returned value is set if the edge crosses the row j (n <= 32)
+    typedef uint32_t (*EdgeCrossingsKernel)( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs );
+
+    private:
+    static EdgeCrossingsKernel kernel;
+    static ISA isa;
+
+    //================
+    // Functions / 関数
+    //================
+    public:
+    static inline uint32_t edge_crossings( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs ){
+        return kernel( y_min, y_max, x_at_y_min, x_at_y_max, dxdy, ys, n, xs );
+    }
+    // The best implementation for the CPU. / CPUに合った実装
+    static ISA detect_isa();
+    static inline ISA get_isa(){ return isa; }
+    // Select the implementation. Returns false if it is not supported. / 実装の切り替え(テスト用)
+    static bool set_isa( const ISA isa );
+    static const char *get_isa_name( const ISA isa );
+    // Compare all supported implementations with the scalar one for random edges.
+    // Returns true if all results are the same. / 全実装の結果がスカラー版と一致するか確認
+    static bool self_test();
+
+    private:
+    static EdgeCrossingsKernel get_kernel( const ISA isa );
+    static uint32_t edge_crossings_scalar( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs );
+#if defined(__x86_64__) || defined(__SSE2__)
+    static uint32_t edge_crossings_sse2( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs );
+    static uint32_t edge_crossings_avx2( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs );
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON)
+    static uint32_t edge_crossings_neon( const float y_min, const float y_max, const float x_at_y_min, const float x_at_y_max, const float dxdy, const float *ys, const uint8_t n, float *xs );
+#endif
+};
+
+#endif
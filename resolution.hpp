@@ -3,6 +3,25 @@
 
 #define COODINATES_RESOLUTION 5
 
+// Default coverage computation of Canvas (can be changed by Canvas::set_coverage_mode)
+//  not defined: COODINATES_RESOLUTION x COODINATES_RESOLUTION supersampling
+//  defined:     exact area coverage (SignedAreaRasterizer)
+//#define USE_ANALYTIC_COVERAGE
+
+// Convex polygons in the supersampling mode
+//  not defined: spans of each row (ActiveEdgeTable)
+//  defined:     blocks of HALF_SPACE_BLOCK_SIZE x HALF_SPACE_BLOCK_SIZE pixels with integer edge functions (HalfSpaceRasterizer)
+//               fill_polygon only: fill_picture keeps the rows, so its edge pixels may differ slightly from fill_polygon.
+//#define USE_HALF_SPACE_RASTERIZER
+#ifndef HALF_SPACE_BLOCK_SIZE
+    #define HALF_SPACE_BLOCK_SIZE 8
+#endif
+
+// Canvas::fill_picture_tiled (bands rendered by several threads, std::thread and std::atomic)
+//  not defined: not available, <thread> and <atomic> are not included
+//  defined:     available
+//#define USE_TILED_RENDERER
+
 #define USE_SINGLE_PRECISION_FLOATING_COORDINATES
 
 #ifndef USE_SINGLE_PRECISION_FLOATING_COORDINATES
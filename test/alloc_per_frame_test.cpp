@@ -0,0 +1,86 @@
+/*==============================================================//
+alloc_per_frame_test
+    Counts the heap allocations of Drawer::draw_clock by a replacement
+    operator new, the same frames as Canvas_Sample_Clock.ino (with a
+    frame arena, as USE_DRAWING_ARENA of the sketch; the clock leaves it
+    empty). After the first frame, no frame may allocate.
+    draw_clockのヒープ確保回数を数える。最初のフレーム以降は0であること。
+
+    Build and run on the host in both coverage modes, from the root of the sketch
+    (SSD1331.cpp, DisplayController.cpp and Timer.cpp need the Arduino core):
+        SRC="Affine2D.cpp AlphaMask.cpp BlendKernels.cpp ClockDrawer.cpp ColoredPolygon.cpp FrameArena.cpp
+             Gradient.cpp Palette.cpp Point2D.cpp Polygon2D.cpp SignedAreaRasterizer.cpp SubsampleKernels.cpp
+             VectorPicture.cpp debug_functions.cpp"
+        g++ -std=gnu++11 -O2 -DDEBUG -I. -o alloc_test test/alloc_per_frame_test.cpp $SRC -pthread && ./alloc_test
+        g++ -std=gnu++11 -O2 -DDEBUG -DUSE_ANALYTIC_COVERAGE -I. -o alloc_test test/alloc_per_frame_test.cpp $SRC -pthread && ./alloc_test
+//==============================================================*/
+#include "ClockDrawer.hpp"
+#include "FrameArena.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static bool counting = false;
+static long n_allocations = 0;
+
+void *operator new( size_t n ){
+    if( counting ){
+        n_allocations++;
+    }
+    void *p = malloc( ( n > 0 ) ? n : 1 );
+    if( p == NULL ){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void *operator new[]( size_t n ){ return operator new( n ); }
+void operator delete( void *p ) noexcept { free( p ); }
+void operator delete[]( void *p ) noexcept { free( p ); }
+void operator delete( void *p, size_t ) noexcept { free( p ); }
+void operator delete[]( void *p, size_t ) noexcept { free( p ); }
+
+int main(){
+    static Drawer drawer;
+    static Canvas_SSD1331 canvas;
+    static uint8_t arena_buffer[ 4096 ];
+    FrameArena arena( arena_buffer, sizeof( arena_buffer ) );
+    drawer.init();
+    canvas.set_frame_arena( &arena );
+
+    // warm up / 初回
+    canvas.set_writable();
+    drawer.draw_clock( canvas, 10, 8, 0.0f );
+    arena.reset();
+
+    long n_frames = 0;
+    counting = true;
+    for( int hour = 0; hour < 12; hour++ ){
+        for( int min = 0; min < 60; min += 7 ){
+            for( float second = 0; second < 60; second += 3.7f ){
+                canvas.set_writable();
+                drawer.draw_clock( canvas, hour, min, second );
+                arena.reset();
+                n_frames++;
+            }
+        }
+    }
+    counting = false;
+
+    const char *mode = ( canvas.get_coverage_mode() == Canvas_SSD1331::ANALYTIC ) ? "ANALYTIC" : "SUPERSAMPLING";
+    printf( "%s: %ld frames, %ld allocations, arena peak %u bytes, %u failures\n", mode, n_frames, n_allocations,
+            static_cast<unsigned int>( arena.get_high_water_mark() ), static_cast<unsigned int>( arena.get_n_failures() ) );
+    bool ok = true;
+    if( n_allocations != 0 ){
+        printf( "FAILED: the frames allocated from the heap\n" );
+        ok = false;
+    }
+    if( canvas.get_frame_arena() != &arena ){
+        printf( "FAILED: the frame arena of the canvas was lost\n" );
+        ok = false;
+    }
+    if( arena.get_n_failures() != 0 ){
+        printf( "FAILED: the frame arena is too small\n" );
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*==============================================================//
+simd_kernels_test
+    Checks the SIMD kernels on the host, for every ISA that set_isa
+    accepts (SCALAR, SSE2, AVX2 or NEON):
+      - SubsampleKernels::self_test() and BlendKernels::self_test()
+      - BlendKernels::blend_span against PixelSpans::alpha_blend of each
+        pixel (RGB565 and RGB565_LE, per pixel and constant alpha)
+      - the clock frames drawn with the ISA against the frames drawn
+        with SCALAR, byte by byte
+    Returns 1 if anything differs.
+    全ての実装(ISA)の結果がスカラー版・alpha_blendと一致するか確認する。
+
+    Build and run on the host, from the root of the sketch
+    (SSD1331.cpp, DisplayController.cpp and Timer.cpp need the Arduino core):
+        SRC="Affine2D.cpp AlphaMask.cpp BlendKernels.cpp ClockDrawer.cpp ColoredPolygon.cpp FrameArena.cpp
+             Gradient.cpp Palette.cpp Point2D.cpp Polygon2D.cpp SignedAreaRasterizer.cpp SubsampleKernels.cpp
+             VectorPicture.cpp debug_functions.cpp"
+        g++ -std=gnu++11 -O2 -DDEBUG -I. -o simd_test test/simd_kernels_test.cpp $SRC -pthread && ./simd_test
+//==============================================================*/
+#include "ClockDrawer.hpp"
+#include "PixelFormat.hpp"
+#include "BlendKernels.hpp"
+#include "SubsampleKernels.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const SubsampleKernels::ISA isas[] = { SubsampleKernels::SCALAR, SubsampleKernels::SSE2, SubsampleKernels::AVX2, SubsampleKernels::NEON };
+static const int n_isas = sizeof( isas ) / sizeof( isas[0] );
+
+// blend_span of the current ISA against alpha_blend of each pixel. Returns the number of the differing pixels.
+// 現在の実装のblend_spanを画素ごとのalpha_blendと比較し、異なる画素数を返す
+template <class Format>
+static long compare_blend_span(){
+    static const int max_n = 67;
+    const bool msb_first = ( Format::byte_order == MSB_FIRST );
+    uint8_t src[ 2 * max_n ];
+    uint8_t out[ 2 * max_n ];
+    uint8_t alphas[ max_n ];
+    long n_diff = 0;
+    unsigned int seed = 7;
+    for( int t = 0; t < 4000; t++ ){
+        const int n = t % max_n + 1;
+        const bool const_alpha = ( t & 1 ) != 0;
+        typename Format::Color color;
+        Format::unpack( rand_r( &seed ) & 0xFFFF, color );
+        const uint8_t alpha = rand_r( &seed ) % 129;
+        for( int i = 0; i < n; i++ ){
+            src[2*i] = rand_r( &seed ) & 0xFF;
+            src[2*i+1] = rand_r( &seed ) & 0xFF;
+            // 0と128も含める
+            alphas[i] = ( i % 5 == 0 ) ? ( i % 2 ) * 128 : rand_r( &seed ) % 129;
+        }
+        memcpy( out, src, 2 * n );
+        if( const_alpha ){
+            BlendKernels::blend_span( out, n, Format::pack( color ), alpha, msb_first );
+        }else{
+            BlendKernels::blend_span( out, alphas, n, Format::pack( color ), msb_first );
+        }
+        for( int i = 0; i < n; i++ ){
+            typename Format::Color org, expected, result;
+            Format::get_Color( src + 2 * i, org );
+            PixelSpans<Format>::alpha_blend( org, color, const_alpha ? alpha : alphas[i], expected );
+            Format::get_Color( out + 2 * i, result );
+            if( memcmp( expected.color, result.color, sizeof( expected.color ) ) != 0 ){
+                n_diff++;
+            }
+        }
+    }
+    return n_diff;
+}
+
+static const int n_canvas_bytes = PixelFormat_RGB565::row_bytes( 96 ) * 64; // Canvas_SSD1331
+
+// Draw the clock frames and append the canvas of each frame to frames. / 各フレームの画素を追加する
+static void draw_frames( Drawer &drawer, Canvas_SSD1331 &canvas, std::vector<uint8_t> &frames ){
+    for( int hour = 0; hour < 12; hour += 5 ){
+        for( float second = 0; second < 60; second += 7.3f ){
+            canvas.set_writable();
+            drawer.draw_clock( canvas, hour, 37, second );
+            frames.insert( frames.end(), canvas.get_pointer_to_data(), canvas.get_pointer_to_data() + n_canvas_bytes );
+        }
+    }
+}
+
+int main(){
+    bool ok = true;
+    if( !SubsampleKernels::self_test() ){
+        printf( "FAILED: SubsampleKernels::self_test\n" );
+        ok = false;
+    }
+    if( !BlendKernels::self_test() ){
+        printf( "FAILED: BlendKernels::self_test\n" );
+        ok = false;
+    }
+
+    static Drawer drawer;
+    static Canvas_SSD1331 canvas;
+    drawer.init();
+    std::vector<uint8_t> scalar_frames;
+    for( int k = 0; k < n_isas; k++ ){
+        const SubsampleKernels::ISA isa = isas[k];
+        if( !SubsampleKernels::set_isa( isa ) ){
+            continue;
+        }
+        if( !BlendKernels::set_isa( isa ) ){
+            printf( "FAILED: %s: BlendKernels::set_isa\n", SubsampleKernels::get_isa_name( isa ) );
+            ok = false;
+            continue;
+        }
+        const long n_diff_565 = compare_blend_span<PixelFormat_RGB565>();
+        const long n_diff_565_le = compare_blend_span<PixelFormat_RGB565_LE>();
+        std::vector<uint8_t> frames;
+        draw_frames( drawer, canvas, frames );
+        if( isa == SubsampleKernels::SCALAR ){
+            scalar_frames = frames;
+        }
+        const bool same_frames = ( frames == scalar_frames );
+        printf( "%s: blend_span %ld / %ld pixels differ, clock frames %s\n", SubsampleKernels::get_isa_name( isa ),
+                n_diff_565, n_diff_565_le, same_frames ? "same as SCALAR" : "differ from SCALAR" );
+        if( n_diff_565 != 0 || n_diff_565_le != 0 || !same_frames ){
+            printf( "FAILED: %s\n", SubsampleKernels::get_isa_name( isa ) );
+            ok = false;
+        }
+    }
+    SubsampleKernels::set_isa( SubsampleKernels::detect_isa() );
+    BlendKernels::set_isa( SubsampleKernels::detect_isa() );
+    return ok ? 0 : 1;
+}